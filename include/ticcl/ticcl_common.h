@@ -27,8 +27,14 @@
 #define TICCL_COMMON_H
 
 #include <map>
+#include <memory>
 #include <set>
+#include <vector>
+#include <algorithm>
 #include <climits>
+#include <cstdint>
+#include <string>
+#include <string_view>
 
 #include "unicode/unistr.h"
 #include "unicode/ustream.h"
@@ -47,8 +53,38 @@ namespace ticcl {
 		const std::map<UChar,bitType>&,
 		bool =false );
 
+  class alphabet_table {
+    // the alphabet as a dense table, indexed by code unit, holding the
+    // class (value, space, punctuation, unknown) of its lowercase form.
+    // It covers the part of the BMP the alphabet needs. Words which
+    // can't be lowercased one code unit at a time take the slow path
+  public:
+    alphabet_table() = default;
+    explicit alphabet_table( const std::map<UChar,bitType>& );
+    void assign( const std::map<UChar,bitType>& );
+    bitType hash( const icu::UnicodeString&, bool =false ) const;
+    const std::map<UChar,bitType>& alphabet() const { return _alphabet; };
+    size_t size() const { return _alphabet.size(); };
+  private:
+    std::map<UChar,bitType> _alphabet;
+    std::vector<uint16_t> _index;
+    std::vector<bitType> _values;
+  };
+
+  bitType hash( const icu::UnicodeString&,
+		const alphabet_table&,
+		bool =false );
+
   unsigned int ldCompare( const icu::UnicodeString&,
 			  const icu::UnicodeString& );
+  unsigned int ldCompareDP( const icu::UnicodeString&,
+			    const icu::UnicodeString& );
+  // the LD when it is at most k, otherwise k+1. Only a band around the
+  // diagonal is computed, in the caller's scratch buffer
+  unsigned int ldWithin( const icu::UnicodeString&,
+			 const icu::UnicodeString&,
+			 unsigned int,
+			 std::vector<unsigned int>& );
 
   bool fillAlphabet( std::istream&,
 		     std::map<UChar,bitType>&,
@@ -122,13 +158,292 @@ namespace ticcl {
     return isletter( charT );
   }
 
-  std::set<bitType> read_bit_set( std::istream& );
-  std::set<bitType> read_anahash( std::istream&,
-				  const int&,
-				  const int&,
-				  size_t&,
-				  bool );
-  std::set<bitType> read_confusions( std::istream& );
+  class flat_set {
+    // a sorted, duplicate free, contiguous set of bitType values.
+    // Much more compact than a std::set, and cache friendly to walk
+  public:
+    using const_iterator = std::vector<bitType>::const_iterator;
+    flat_set() = default;
+    explicit flat_set( std::vector<bitType>&& );
+    void assign( std::vector<bitType>&& );
+    size_t size() const { return _vals.size(); };
+    bool empty() const { return _vals.empty(); };
+    const bitType *data() const { return _vals.data(); };
+    bitType operator[]( size_t i ) const { return _vals[i]; };
+    bitType front() const { return _vals.front(); };
+    bitType back() const { return _vals.back(); };
+    const_iterator begin() const { return _vals.begin(); };
+    const_iterator end() const { return _vals.end(); };
+    const_iterator lower_bound( bitType v ) const {
+      return std::lower_bound( _vals.begin(), _vals.end(), v );
+    };
+    const_iterator find( bitType ) const;
+    bool contains( bitType v ) const { return find( v ) != end(); };
+  private:
+    std::vector<bitType> _vals;
+  };
+
+  class flat_hash_set {
+    // a static open addressing hash set of bitType values, for fast
+    // membership tests on a set that doesn't change after loading.
+    // Lookups outside [front,back] of the source set are rejected first
+  public:
+    flat_hash_set() = default;
+    explicit flat_hash_set( const flat_set& );
+    void assign( const flat_set& );
+    size_t size() const { return _size; };
+    bool contains( bitType v ) const {
+      if ( v < _min || v > _max ){
+	return false;
+      }
+      if ( v == 0 ){
+	return _has_zero;
+      }
+      for ( size_t i = slot( v ); ; i = (i+1) & _mask ){
+	bitType t = _table[i];
+	if ( t == v ){
+	  return true;
+	}
+	if ( t == 0 ){
+	  return false;
+	}
+      }
+    };
+  private:
+    size_t slot( bitType v ) const {
+      // Fibonacci hashing: the high bits of the product are well mixed
+      return (v * 0x9E3779B97F4A7C15ULL) >> _shift;
+    };
+    std::vector<bitType> _table; // 0 marks an empty slot
+    size_t _mask = 0;
+    int _shift = 63;
+    size_t _size = 0;
+    bitType _min = 1;
+    bitType _max = 0;
+    bool _has_zero = false;
+  };
+
+  enum join_mode { LINEAR_JOIN, GALLOP_JOIN, SIMD_JOIN };
+
+  void shifted_join( const flat_set&,
+		     bitType,
+		     std::vector<bitType>&,
+		     join_mode =SIMD_JOIN );
+  std::string simd_support();
+
+  flat_set read_bit_set( std::istream& );
+  flat_set read_anahash( std::istream&,
+			 const int&,
+			 const int&,
+			 size_t&,
+			 bool );
+  flat_set read_confusions( std::istream& );
+
+  class anahash_file {
+    // a read-only, memory mapped view on a binary anagram hash file, as
+    // written by write_anahash_bin(). The layout is:
+    //   header: magic, byte order mark, #hashes (N), #words (M), pool size
+    //   bitType  hashes[N]       sorted
+    //   uint64_t word_start[N+1] index in word_offs of the first word
+    //   uint64_t word_offs[M+1]  byte offset of every word in the pool
+    //   uint32_t first_len[N]    UTF-16 length of the first word
+    //   char     pool[]          UTF-8 words, without separators
+  public:
+    anahash_file() = default;
+    explicit anahash_file( const std::string& );
+    ~anahash_file();
+    anahash_file( const anahash_file& ) = delete;
+    anahash_file& operator=( const anahash_file& ) = delete;
+    void open( const std::string& );
+    void close();
+    size_t size() const { return _n_hashes; };
+    size_t word_total() const { return _n_words; };
+    const bitType *hashes() const { return _hashes; };
+    bitType hash_at( size_t i ) const { return _hashes[i]; };
+    size_t word_count( size_t i ) const {
+      return _word_start[i+1] - _word_start[i];
+    };
+    size_t first_length( size_t i ) const { return _first_len[i]; };
+    std::string_view word_utf8( size_t i, size_t j ) const {
+      size_t w = _word_start[i] + j;
+      return std::string_view( _pool + _word_offs[w],
+			       _word_offs[w+1] - _word_offs[w] );
+    };
+    icu::UnicodeString word( size_t, size_t ) const;
+  private:
+    void *_map = 0;
+    size_t _map_size = 0;
+    size_t _n_hashes = 0;
+    size_t _n_words = 0;
+    const bitType *_hashes = 0;
+    const uint64_t *_word_start = 0;
+    const uint64_t *_word_offs = 0;
+    const uint32_t *_first_len = 0;
+    const char *_pool = 0;
+  };
+
+  bool is_anahash_bin( const std::string& );
+  void write_anahash_bin( std::ostream&,
+			  const std::map<bitType,std::set<icu::UnicodeString>>& );
+  flat_set read_anahash( const anahash_file&,
+			 const int&,
+			 const int&,
+			 size_t&,
+			 bool );
+  flat_set read_anahash( const std::string&,
+			 const int&,
+			 const int&,
+			 size_t&,
+			 bool );
+
+  bool is_index_bin( const std::string& );
+
+  class index_writer {
+    // writes a binary index file: a header with the number of entries,
+    // followed by the entries. An entry is a confusion value, the number of
+    // anagram values and the ascending anagram values, delta coded.
+    // All as varints.
+  public:
+    explicit index_writer( std::ostream& );
+    static void encode( std::string&, bitType, const std::vector<bitType>& );
+    void add( bitType, const std::vector<bitType>& );
+    // when encoded entries are written to the stream directly,
+    // register their number here
+    void added( size_t n ){ _entries += n; };
+    void finish();
+  private:
+    std::ostream& _os;
+    size_t _entries;
+    std::streampos _start;
+  };
+
+  class index_reader {
+  public:
+    explicit index_reader( std::istream& );
+    size_t size() const { return _entries; };
+    bool next( bitType&, std::vector<bitType>& );
+  private:
+    uint64_t get_varint();
+    std::istream& _is;
+    size_t _entries;
+    size_t _read;
+  };
+
+  class word_table {
+    // interns words: every distinct word gets a dense 32 bit ID, in order
+    // of arrival, so data about words can be kept in vectors indexed by ID.
+    // The words live in one UTF-16 pool, with an open addressing table on
+    // top for the lookups. Every word may carry a count (frequency).
+    // A table can be saved as a vocabulary file, which is opened again
+    // read-only and memory mapped, without rebuilding anything.
+  public:
+    static constexpr uint32_t npos = UINT32_MAX;
+    word_table();
+    explicit word_table( const std::string& );
+    ~word_table();
+    word_table( const word_table& ) = delete;
+    word_table& operator=( const word_table& ) = delete;
+    size_t size() const { return _size; };
+    bool empty() const { return _size == 0; };
+    bool read_only() const { return _map != 0; };
+    uint32_t intern( const icu::UnicodeString& );
+    uint32_t find( const icu::UnicodeString& ) const;
+    bool contains( const icu::UnicodeString& w ) const {
+      return find( w ) != npos;
+    };
+    const UChar *data( uint32_t id ) const { return _pool + _offs[id]; };
+    size_t length( uint32_t id ) const {
+      return _offs[id+1] - _offs[id];
+    };
+    // a read-only alias of the pool. No copy is made.
+    icu::UnicodeString word( uint32_t id ) const {
+      return icu::UnicodeString( false, data( id ), length( id ) );
+    };
+    uint64_t count( uint32_t id ) const { return _counts[id]; };
+    void set_count( uint32_t, uint64_t );
+    std::vector<uint32_t> sorted() const; // the IDs, in word order
+    void write( std::ostream& ) const;
+    void open( const std::string& );
+    void close();
+  private:
+    uint32_t lookup( const UChar *, size_t, uint32_t, size_t& ) const;
+    void grow();
+    void refresh();
+    // the views, pointing to either the vectors or the mapped file
+    const UChar *_pool;
+    const uint64_t *_offs;
+    const uint64_t *_counts;
+    const uint32_t *_hashes;
+    const uint32_t *_slots;
+    size_t _size;
+    size_t _mask;
+    std::vector<UChar> _pool_v;
+    std::vector<uint64_t> _offs_v;
+    std::vector<uint64_t> _counts_v;
+    std::vector<uint32_t> _hashes_v;
+    std::vector<uint32_t> _slots_v; // npos marks an empty slot
+    void *_map;
+    size_t _map_size;
+  };
+
+  bool is_vocab_file( const std::string& );
+
+  class lexicon {
+    // a word frequency list, optimized for lookups. Every word is linked
+    // to its lowercased form, which has a frequency of its own. Both
+    // sides are word_tables, so words are hashed into a UTF-16 pool and
+    // addressed by ID. How the frequencies combine is up to the user.
+  public:
+    lexicon() = default;
+    uint32_t add( const icu::UnicodeString& );
+    size_t size() const { return _words.size(); };
+    size_t low_size() const { return _low.size(); };
+    bool empty() const { return _words.empty(); };
+    uint32_t find( const icu::UnicodeString& w ) const {
+      return _words.find( w );
+    };
+    uint32_t find_low( const icu::UnicodeString& lw ) const {
+      return _low.find( lw );
+    };
+    icu::UnicodeString word( uint32_t id ) const { return _words.word( id ); };
+    icu::UnicodeString low_word( uint32_t l ) const { return _low.word( l ); };
+    uint32_t low_id( uint32_t id ) const { return _low_ids[id]; };
+    uint64_t freq( uint32_t id ) const { return _words.count( id ); };
+    uint64_t low_freq( uint32_t l ) const { return _low.count( l ); };
+    // 0 for unknown words
+    uint64_t freq_of( const icu::UnicodeString& ) const;
+    uint64_t low_freq_of( const icu::UnicodeString& ) const;
+    void set_freq( uint32_t id, uint64_t f ){ _words.set_count( id, f ); };
+    void set_low_freq( uint32_t l, uint64_t f ){ _low.set_count( l, f ); };
+    uint64_t add_freq( uint32_t id, uint64_t f ){
+      set_freq( id, freq( id ) + f );
+      return freq( id );
+    };
+    std::vector<uint32_t> sorted() const { return _words.sorted(); };
+  private:
+    word_table _words;
+    word_table _low;
+    std::vector<uint32_t> _low_ids; // word ID -> ID of the lowercased form
+  };
+
+  class word_counter {
+    // counts words from the threads of an OpenMP parallel region, without
+    // locking: every thread counts in a word_table of its own. merge()
+    // adds them all up, after the parallel part.
+    // The tables are picked by omp_get_thread_num(), which is only unique
+    // in an outermost parallel region. Inside nested regions, add() falls
+    // back to one shared table under a lock: correct, but slow.
+  public:
+    word_counter();
+    word_counter( const word_counter& ) = delete;
+    word_counter& operator=( const word_counter& ) = delete;
+    void add( const icu::UnicodeString&, uint64_t =1 );
+    const word_table& merge();
+  private:
+    // one table per thread, plus a spare one for threads beyond those
+    // we expected, which is only used in a critical section
+    std::vector<std::unique_ptr<word_table>> _tables;
+  };
 
 } // namespace ticcl
 
@@ -32,6 +32,7 @@
 #include <limits>
 #include <vector>
 #include <cstdlib>
+#include <cstdio>
 #include <string>
 #include <stdexcept>
 #include <iostream>
@@ -58,7 +59,9 @@ void usage( const string& progname ){
   cerr << "usage: " << progname << endl;
   cerr << "\t--index <confuslist>\t inputfile produced by TICCL-indexer or TICCL-indexerNT." << endl;
   cerr << "\t--hash <anahash>\t a file produced by TICCl-anahash," << endl;
-  cerr << "\t--clean <cleanfile>\t a file produced by TICCL-unk" << endl;
+  cerr << "\t\t\t either in text or in binary (--bin) format." << endl;
+  cerr << "\t--clean <cleanfile>\t a file produced by TICCL-unk," << endl;
+  cerr << "\t\t\t either the .clean file or its binary .vocab version." << endl;
   cerr << "\t--diac <diacriticsfile>\t a list of 'diacritical' confusions." << endl;
   cerr << "\t--hist <historicalfile>\t a list of 'historical' confusions." << endl;
   cerr << "\t--alph <alphabet>\t alphabet file (as produced by TICCL-lexstat)" << endl;
@@ -75,6 +78,10 @@ void usage( const string& progname ){
   cerr << "\t--high=<high>\t skip entries from the anagram file longer than "
        << endl;
   cerr << "\t\t\t'high' characters. (default=35)" << endl;
+  cerr << "\t--maxmem=<MB>\t keep the memory used for the results below about"
+       << endl;
+  cerr << "\t\t\t'MB' megabytes, by spilling them to sorted run files" << endl;
+  cerr << "\t\t\t which are merged at the end. (default: no limit)" << endl;
   cerr << "\t-v\t\t be verbose, repeat to be more verbose " << endl;
   cerr << "\t-h or --help\t this message " << endl;
   cerr << "\t-V or --version\t show version " << endl;
@@ -83,6 +90,18 @@ void usage( const string& progname ){
 
 set<UnicodeString> follow_words;
 map<UChar,bitType> alphabet;
+size_t store_bytes = 0; // rough estimate of the memory used by the results
+// scratch space for ticcl::ldWithin, one per thread
+static thread_local vector<unsigned int> ld_scratch;
+
+struct set_entry {
+  // what the pre-checks need to know about a word of an anagram set.
+  // computed once per set, instead of once for every pair
+  const UnicodeString *word;
+  UnicodeString low;
+  size_t low_freq;
+  bool clean; // all characters of 'low' are in the alphabet
+};
 
 class ld_record {
 public:
@@ -90,8 +109,14 @@ public:
 	     const UnicodeString&,
 	     bitType key1,
 	     bitType key2,
-	     const map<UnicodeString,size_t>&,
-	     const map<UnicodeString,size_t>&,
+	     const ticcl::lexicon&,
+	     bool, bool, bool,
+	     bool );
+  ld_record( const set_entry&,
+	     const set_entry&,
+	     bitType key1,
+	     bitType key2,
+	     const ticcl::lexicon&,
 	     bool, bool, bool,
 	     bool );
   void flip(){
@@ -100,19 +125,20 @@ public:
     swap( freq1, freq2 );
     swap( low_freq1, low_freq2 );
   }
-  bool analyze_ngrams( const map<UnicodeString, size_t>&,
+  bool analyze_ngrams( const ticcl::lexicon&,
 		       size_t, size_t,
 		       map<UnicodeString,set<UnicodeString>>&,
 		       map<UnicodeString, size_t>&,
 		       map<UnicodeString, size_t>& );
   bool handle_the_pair( const UnicodeString&,
 			const UnicodeString&,
-			const map<UnicodeString, size_t>&,
+			const ticcl::lexicon&,
 			size_t,
 			size_t,
 			map<UnicodeString,set<UnicodeString>>&,
 			map<UnicodeString, size_t>&,
 			map<UnicodeString, size_t>& );
+  unsigned int ld_upto( int ) const;
   bool ld_is( int );
   bool ld_check( int );
   void fill_fields( size_t );
@@ -148,8 +174,7 @@ public:
 ld_record::ld_record( const UnicodeString& s1,
 		      const UnicodeString& s2,
 		      bitType key1, bitType key2,
-		      const map<UnicodeString,size_t>& f_map,
-		      const map<UnicodeString,size_t>& low_f_map,
+		      const ticcl::lexicon& lexicon,
 		      bool is_KHC, bool no_KHCld, bool is_diachrone,
 		      bool following ):
   str1(s1),
@@ -167,48 +192,54 @@ ld_record::ld_record( const UnicodeString& s1,
   noKHCld(no_KHCld),
   is_diac(is_diachrone)
 {
-  auto const it1 = f_map.find( s1 );
-  if ( it1 != f_map.end() ){
-    freq1 = it1->second;
-  }
-  else {
-    freq1 = 0;
-  }
+  freq1 = lexicon.freq_of( str1 );
   ls1 = str1;
   ls1.toLower();
-  auto const lit1 = low_f_map.find( ls1 );
-  if ( lit1 != low_f_map.end() ){
-    low_freq1 = lit1->second;
-  }
-  else {
-    low_freq1 = 0;
-  }
-  auto const it2 = f_map.find( s2 );
-  if ( it2 != f_map.end() ){
-    freq2 = it2->second;
-  }
-  else {
-    freq2 = 0;
-  }
+  low_freq1 = lexicon.low_freq_of( ls1 );
+  freq2 = lexicon.freq_of( str2 );
   ls2 = str2;
   ls2.toLower();
-  auto const lit2 = low_f_map.find( ls2 );
-  if ( lit2 != low_f_map.end() ){
-    low_freq2 = lit2->second;
-  }
-  else {
-    low_freq2 = 0;
-  }
+  low_freq2 = lexicon.low_freq_of( ls2 );
   follow = following;
 }
 
+ld_record::ld_record( const set_entry& e1,
+		      const set_entry& e2,
+		      bitType key1, bitType key2,
+		      const ticcl::lexicon& lexicon,
+		      bool is_KHC, bool no_KHCld, bool is_diachrone,
+		      bool following ):
+  str1(*e1.word),
+  ls1(e1.low),
+  low_freq1(e1.low_freq),
+  str2(*e2.word),
+  ls2(e2.low),
+  low_freq2(e2.low_freq),
+  ld(-1),
+  cls(0),
+  KWC(0),
+  _key1(key1),
+  _key2(key2),
+  canon(false),
+  FLoverlap(false),
+  LLoverlap(false),
+  ngram_point(0),
+  isKHC(is_KHC),
+  noKHCld(no_KHCld),
+  is_diac(is_diachrone),
+  follow(following)
+{
+  freq1 = lexicon.freq_of( str1 );
+  freq2 = lexicon.freq_of( str2 );
+}
+
 UnicodeString ld_record::get_key() const {
   return str1 + "~" + str2;
 }
 
 bool ld_record::handle_the_pair( const UnicodeString& diff_part1,
 				 const UnicodeString& diff_part2,
-				 const map<UnicodeString, size_t>& low_freqMap,
+				 const ticcl::lexicon& lexicon,
 				 size_t freqThreshold,
 				 size_t low_limit,
 				 map<UnicodeString,set<UnicodeString>>& dis_map,
@@ -232,11 +263,11 @@ bool ld_record::handle_the_pair( const UnicodeString& diff_part1,
 
   UnicodeString lp = diff_part1;
   lp.toLower();
-  auto const& entry1 = low_freqMap.find( lp );
+  uint32_t entry1 = lexicon.find_low( lp );
   lp = diff_part2;
   lp.toLower();
-  if ( entry1 != low_freqMap.end()
-       && entry1->second >= freqThreshold ){
+  if ( entry1 != ticcl::word_table::npos
+       && lexicon.low_freq( entry1 ) >= freqThreshold ){
     if ( follow ){
 #pragma omp critical (debugout)
       {
@@ -254,7 +285,11 @@ bool ld_record::handle_the_pair( const UnicodeString& diff_part1,
     // count this short words pair AND store the original n-gram pair
 #pragma omp critical (update)
     {
-      dis_map[disamb_pair].insert( str1 + "~" + str2 );
+      UnicodeString parent = str1 + "~" + str2;
+      if ( dis_map[disamb_pair].insert( parent ).second ){
+#pragma omp atomic
+	store_bytes += 64 + 2 * ( parent.length() + disamb_pair.length() );
+      }
       ++dis_count[disamb_pair];
     }
     if ( follow ){
@@ -285,7 +320,7 @@ bool ld_record::handle_the_pair( const UnicodeString& diff_part1,
   return true; // forget the original parents
 }
 
-bool ld_record::analyze_ngrams( const map<UnicodeString, size_t>& low_freqMap,
+bool ld_record::analyze_ngrams( const ticcl::lexicon& lexicon,
 				size_t freqThreshold,
 				size_t low_limit,
 				map<UnicodeString,set<UnicodeString>>& dis_map,
@@ -334,7 +369,7 @@ bool ld_record::analyze_ngrams( const map<UnicodeString, size_t>& low_freqMap,
 	return true; // discard
       }
     }
-    return handle_the_pair( diff_part1, diff_part2, low_freqMap,
+    return handle_the_pair( diff_part1, diff_part2, lexicon,
 			    freqThreshold,
 			    low_limit,
 			    dis_map,
@@ -346,8 +381,17 @@ bool ld_record::analyze_ngrams( const map<UnicodeString, size_t>& low_freqMap,
   }
 }
 
+unsigned int ld_record::ld_upto( int max_ld ) const {
+  // only when following, or when a KHC record may exceed max_ld, do we
+  // need the exact distance. Otherwise anything above max_ld will do
+  if ( follow || ( isKHC && noKHCld ) ){
+    return ticcl::ldCompare( ls1, ls2 );
+  }
+  return ticcl::ldWithin( ls1, ls2, max_ld, ld_scratch );
+}
+
 bool ld_record::ld_is( int wanted ) {
-  ld = ticcl::ldCompare( ls1, ls2 );
+  ld = ld_upto( wanted );
   if ( ld != wanted ){
     if ( !( isKHC && noKHCld ) ){
       if ( follow ){
@@ -376,7 +420,7 @@ bool ld_record::ld_is( int wanted ) {
 }
 
 bool ld_record::ld_check( int ldvalue ) {
-  ld = ticcl::ldCompare( ls1, ls2 );
+  ld = ld_upto( ldvalue );
   if ( ld <= ldvalue ){
     // LD is ok
     if ( follow ){
@@ -503,6 +547,13 @@ void ld_record::fill_fields( size_t freqThreshold ) {
   }
 }
 
+size_t record_bytes( const UnicodeString& key, const ld_record& rec ){
+  // a rough estimate of the memory used by one record_store entry
+  return sizeof(pair<const UnicodeString,ld_record>) + 48
+    + 2 * ( key.length() + rec.str1.length() + rec.str2.length()
+	    + rec.ls1.length() + rec.ls2.length() );
+}
+
 string ld_record::toString() const {
   string canon_s = (canon?"1":"0");;
   string FLoverlap_s = (FLoverlap?"1":"0");;
@@ -518,8 +569,64 @@ string ld_record::toString() const {
   return ss.str();
 }
 
+void prepare_set( const set<UnicodeString>& s,
+		  const ticcl::lexicon& lexicon,
+		  const map<UChar,bitType>& alphabet,
+		  vector<set_entry>& entries ){
+  // the vector is reused between calls, so mostly no new buffers are needed
+  entries.resize( s.size() );
+  size_t i = 0;
+  for ( const auto& word : s ){
+    set_entry& e = entries[i++];
+    e.word = &word;
+    e.low = word;
+    e.low.toLower();
+    e.low_freq = lexicon.low_freq_of( e.low );
+    e.clean = true;
+    if ( !alphabet.empty() ){
+      for ( int j=0; j < e.low.length(); ++j ){
+	if ( alphabet.find( e.low[j] ) == alphabet.end() ){
+	  e.clean = false;
+	  break;
+	}
+      }
+    }
+  }
+}
+
+bool freq_filter( const set_entry& e1,
+		  const set_entry& e2,
+		  bitType key1,
+		  bitType key2,
+		  size_t threshold,
+		  bool is_diac,
+		  bool test_cc ){
+  // does the pair survive ld_record::sort_high_second() + acceptable(),
+  // and when test_cc is set, test_frequency() too?
+  // Decided without building the record
+  bool flip;
+  if ( e1.low_freq == e2.low_freq ){
+    flip = key1 < key2;
+  }
+  else {
+    flip = e1.low_freq > e2.low_freq;
+  }
+  const set_entry& var = flip ? e2 : e1;
+  const set_entry& cc = flip ? e1 : e2;
+  if ( var.low_freq >= threshold && !is_diac ){
+    return false;
+  }
+  if ( !cc.clean ){
+    return false;
+  }
+  if ( test_cc && cc.low_freq < threshold ){
+    return false;
+  }
+  return true;
+}
+
 bool transpose_pair( ld_record& record,
-		     const map<UnicodeString,size_t>& low_freqMap,
+		     const ticcl::lexicon& lexicon,
 		     map<UnicodeString,set<UnicodeString>>& dis_map,
 		     map<UnicodeString, size_t>& dis_count,
 		     map<UnicodeString, size_t>& ngram_count,
@@ -541,7 +648,7 @@ bool transpose_pair( ld_record& record,
   if ( !record.test_frequency( freqThreshold ) ){
     return false;
   }
-  if ( record.analyze_ngrams( low_freqMap, freqThreshold, low_limit,
+  if ( record.analyze_ngrams( lexicon, freqThreshold, low_limit,
 			      dis_map, dis_count, ngram_count ) ){
     return false;
   }
@@ -563,8 +670,7 @@ bool transpose_pair( ld_record& record,
 
 void handleTranspositions( const set<UnicodeString>& s,
 			   bitType key,
-			   const map<UnicodeString,size_t>& freqMap,
-			   const map<UnicodeString,size_t>& low_freqMap,
+			   const ticcl::lexicon& lexicon,
 			   const map<UChar,bitType>& alphabet,
 			   map<UnicodeString,set<UnicodeString>>& dis_map,
 			   map<UnicodeString, size_t>& dis_count,
@@ -575,25 +681,29 @@ void handleTranspositions( const set<UnicodeString>& s,
 			   bool noKHCld,
 			   bool isDIAC,
 			   map<UnicodeString,ld_record>& record_store ){
-  auto it1 = s.begin();
-  while ( it1 != s.end() ) {
+  static thread_local vector<set_entry> entries;
+  prepare_set( s, lexicon, alphabet, entries );
+  for ( size_t i1=0; i1 < entries.size(); ++i1 ){
     bool following = false;
-    UnicodeString str1 = *it1;
+    const UnicodeString& str1 = *entries[i1].word;
     if ( follow_words.find( str1 ) != follow_words.end() ){
       following = true;
     }
-    auto it2 = it1;
-    ++it2;
-    while ( it2 != s.end() ) {
-      UnicodeString str2 = *it2;
+    for ( size_t i2=i1+1; i2 < entries.size(); ++i2 ){
+      const UnicodeString& str2 = *entries[i2].word;
       if ( follow_words.find( str2 ) != follow_words.end() ){
 	following = true;
       }
-      ld_record record( str1, str2,
+      if ( !following
+	   && !freq_filter( entries[i1], entries[i2], key, key,
+			    freqThreshold, isDIAC, true ) ){
+	continue;
+      }
+      ld_record record( entries[i1], entries[i2],
 			key, key,
-			freqMap, low_freqMap,
+			lexicon,
 			isKHC, noKHCld, isDIAC, following );
-      if ( transpose_pair( record, low_freqMap,
+      if ( transpose_pair( record, lexicon,
 			   dis_map, dis_count, ngram_count,
 			   freqThreshold, low_limit, alphabet, following ) ){
 	UnicodeString key_string = record.get_key();
@@ -608,21 +718,22 @@ void handleTranspositions( const set<UnicodeString>& s,
 		   << record_store.find(key_string)->second.toString() << endl;
 	    }
 	  }
-	  record_store.emplace(key_string,record);
+	  if ( record_store.emplace(key_string,record).second ){
+#pragma omp atomic
+	    store_bytes += record_bytes( key_string, record );
+	  }
 	  if ( following ){
 	    cerr << "1 emplaced result      : " << record.toString() << endl;
 	  }
 	}
       }
-      ++it2;
     }
-    ++it1;
   }
 }
 
 
 bool compare_pair( ld_record& record,
-		   const map<UnicodeString,size_t>& low_freqMap,
+		   const ticcl::lexicon& lexicon,
 		   int ldValue,
 		   bitType KWC,
 		   map<UnicodeString,set<UnicodeString>>& dis_map,
@@ -638,7 +749,7 @@ bool compare_pair( ld_record& record,
   if ( !record.acceptable( freqThreshold, alphabet) ){
     return false;
   }
-  if ( record.analyze_ngrams( low_freqMap, freqThreshold, low_limit,
+  if ( record.analyze_ngrams( lexicon, freqThreshold, low_limit,
 			      dis_map, dis_count, ngram_count ) ){
     return false;
   }
@@ -652,8 +763,7 @@ void compareSets( int ldValue,
 		  bitType key1,
 		  const set<UnicodeString>& s1,
 		  const set<UnicodeString>& s2,
-		  const map<UnicodeString,size_t>& freqMap,
-		  const map<UnicodeString,size_t>& low_freqMap,
+		  const ticcl::lexicon& lexicon,
 		  const map<UChar,bitType>& alphabet,
 		  map<UnicodeString,set<UnicodeString>>& dis_map,
 		  map<UnicodeString, size_t>& dis_count,
@@ -667,10 +777,15 @@ void compareSets( int ldValue,
   // using TiCC::operator<<;
   // cerr << "set 1 " << s1 << endl;
   // cerr << "set 2 " << s2 << endl;
-  auto it1 = s1.begin();
-  while ( it1 != s1.end() ) {
+  static thread_local vector<set_entry> entries1;
+  static thread_local vector<set_entry> entries2;
+  prepare_set( s1, lexicon, alphabet, entries1 );
+  prepare_set( s2, lexicon, alphabet, entries2 );
+  // KHC records may be kept whatever their LD
+  const bool ld_filter = !( isKHC && noKHCld );
+  for ( const auto& e1 : entries1 ){
     bool following = false;
-    UnicodeString str1 = *it1;
+    const UnicodeString& str1 = *e1.word;
     if ( follow_words.find( str1 ) != follow_words.end() ){
       following = true;
     }
@@ -680,9 +795,8 @@ void compareSets( int ldValue,
 	cout << "SET: string 1 " << str1 << endl;
       }
     }
-    auto it2 = s2.begin();
-    while ( it2 != s2.end() ) {
-      UnicodeString str2 = *it2;
+    for ( const auto& e2 : entries2 ){
+      const UnicodeString& str2 = *e2.word;
       if ( follow_words.find( str2 ) != follow_words.end() ){
 	following = true;
       }
@@ -692,11 +806,23 @@ void compareSets( int ldValue,
 	  cout << "SET: string 2 " << str2 << endl;
 	}
       }
-      ld_record record( str1, str2,
+      else {
+	// reject what compare_pair() would reject, before building a record
+	if ( ld_filter
+	     && ticcl::ldWithin( e1.low, e2.low, ldValue, ld_scratch )
+	     > (unsigned int)ldValue ){
+	  continue;
+	}
+	if ( !freq_filter( e1, e2, key1, KWC + key1,
+			   freqThreshold, isDIAC, false ) ){
+	  continue;
+	}
+      }
+      ld_record record( e1, e2,
 			key1, KWC + key1,
-			freqMap, low_freqMap,
+			lexicon,
 			isKHC, noKHCld, isDIAC, following );
-      if ( compare_pair( record, low_freqMap, ldValue, KWC,
+      if ( compare_pair( record, lexicon, ldValue, KWC,
 			 dis_map, dis_count, ngram_count,
 			 freqThreshold, low_limit, alphabet ) ){
 	UnicodeString key = record.get_key();
@@ -712,25 +838,25 @@ void compareSets( int ldValue,
 		   << " By      : " << record.toString() << endl;
 	    }
 	  }
-	  record_store.emplace(key,record);
+	  if ( record_store.emplace(key,record).second ){
+#pragma omp atomic
+	    store_bytes += record_bytes( key, record );
+	  }
 	}
       }
-      ++it2;
     }
-    ++it1;
   }
 }
 
 void add_short( ostream& os,
 		const map<UnicodeString,size_t>& dis_count,
-		const map<UnicodeString,size_t>& freqMap,
-		const map<UnicodeString,size_t>& low_freqMap,
+		const ticcl::lexicon& lexicon,
 		int max_ld, size_t threshold ){
   for ( const auto& [word,point] : dis_count ){
     vector<UnicodeString> parts = TiCC::split_at( word, "~" );
     ld_record rec( parts[0], parts[1],
 		   0, 0,
-		   freqMap, low_freqMap,
+		   lexicon,
 		   false, false, false, false );
     if ( !rec.ld_check( max_ld ) ){
       continue;
@@ -741,6 +867,175 @@ void add_short( ostream& os,
   }
 }
 
+void write_records( ostream& os,
+		    const map<UnicodeString,ld_record>& record_store ){
+  for ( const auto& r : record_store ){
+    os << r.second.toString() << endl;
+  }
+}
+
+void write_ambi( ostream& os,
+		 const map<UnicodeString,set<UnicodeString>>& dis_map ){
+  for ( const auto& [word,ambi_set] : dis_map ){
+    os << word << "#";
+    for ( const auto& val : ambi_set ){
+      os << val << "#";
+    }
+    os << endl;
+  }
+}
+
+void spill_results( map<UnicodeString,ld_record>& record_store,
+		    map<UnicodeString,set<UnicodeString>>& dis_map,
+		    const string& out_file,
+		    const string& ambi_file,
+		    vector<string>& record_runs,
+		    vector<string>& ambi_runs ){
+  // write the results gathered so far to sorted run files and free them
+  string run_name = out_file + ".run" + to_string( record_runs.size() );
+  ofstream os( run_name );
+  write_records( os, record_store );
+  if ( !os ){
+    cerr << progname << ": problem writing run file: " << run_name << endl;
+    exit(EXIT_FAILURE);
+  }
+  record_runs.push_back( run_name );
+  run_name = ambi_file + ".run" + to_string( ambi_runs.size() );
+  ofstream as( run_name );
+  write_ambi( as, dis_map );
+  if ( !as ){
+    cerr << progname << ": problem writing run file: " << run_name << endl;
+    exit(EXIT_FAILURE);
+  }
+  ambi_runs.push_back( run_name );
+  if ( verbose ){
+    cout << progname << ": spilled " << record_store.size()
+	 << " records to run " << record_runs.size() << endl;
+  }
+  record_store.clear();
+  dis_map.clear();
+  store_bytes = 0;
+}
+
+class run_reader {
+  // reads a sorted run file line by line. The key of a line is the
+  // part before the first '#' (.ambi runs) or the two words (records)
+public:
+  run_reader( const string& name, bool ambi ):
+    is( name ), is_ambi( ambi ), live( false ) {
+    next();
+  };
+  void next(){
+    live = false;
+    while ( TiCC::getline( is, line ) ){
+      if ( line.isEmpty() ){
+	continue;
+      }
+      if ( is_ambi ){
+	key = TiCC::split_at( line, "#" )[0];
+      }
+      else {
+	vector<UnicodeString> parts = TiCC::split_at( line, "~" );
+	key = parts[0] + "~" + parts[3];
+      }
+      live = true;
+      return;
+    }
+  };
+  ifstream is;
+  bool is_ambi;
+  bool live;
+  UnicodeString line;
+  UnicodeString key;
+};
+
+int smallest_run( const vector<run_reader*>& runs ){
+  // the first run with the smallest key, or -1 when all are exhausted
+  int best = -1;
+  for ( size_t k=0; k < runs.size(); ++k ){
+    if ( runs[k]->live
+	 && ( best < 0 || runs[k]->key < runs[best]->key ) ){
+      best = k;
+    }
+  }
+  return best;
+}
+
+void merge_records( ostream& os,
+		    const vector<string>& run_names,
+		    const map<UnicodeString,size_t>& ngram_count,
+		    const map<UnicodeString,unsigned int>& low_ngramcount ){
+  // k-way merge of the record runs. When a key is present in more than
+  // one run, the earliest run wins, as record_store.emplace() would have
+  // done. The ngram points are added on the fly
+  vector<run_reader*> runs;
+  for ( const auto& name : run_names ){
+    runs.push_back( new run_reader( name, false ) );
+  }
+  int best;
+  while ( (best = smallest_run( runs )) >= 0 ){
+    UnicodeString key = runs[best]->key;
+    UnicodeString line = runs[best]->line;
+    for ( const auto& r : runs ){
+      while ( r->live && r->key == key ){
+	r->next();
+      }
+    }
+    if ( ngram_count.find( key ) != ngram_count.end() ){
+      UnicodeString lv = key;
+      lv.toLower();
+      int pos = line.lastIndexOf( '~' );
+      UnicodeString point_s( line, pos+1 );
+      int point = TiCC::stringTo<int>( point_s );
+      point += low_ngramcount.at( lv );
+      line.truncate( pos+1 );
+      line += TiCC::toUnicodeString( point );
+    }
+    os << line << endl;
+  }
+  for ( const auto& r : runs ){
+    delete r;
+  }
+}
+
+void merge_ambi( ostream& os,
+		 const vector<string>& run_names ){
+  // k-way merge of the .ambi runs, joining the sets of equal keys
+  vector<run_reader*> runs;
+  for ( const auto& name : run_names ){
+    runs.push_back( new run_reader( name, true ) );
+  }
+  int best;
+  while ( (best = smallest_run( runs )) >= 0 ){
+    UnicodeString key = runs[best]->key;
+    set<UnicodeString> ambi_set;
+    for ( const auto& r : runs ){
+      while ( r->live && r->key == key ){
+	vector<UnicodeString> parts = TiCC::split_at( r->line, "#" );
+	ambi_set.insert( parts.begin()+1, parts.end() );
+	r->next();
+      }
+    }
+    os << key << "#";
+    for ( const auto& val : ambi_set ){
+      os << val << "#";
+    }
+    os << endl;
+  }
+  for ( const auto& r : runs ){
+    delete r;
+  }
+}
+
+struct work_item {
+  // one anagram value from an index entry, with its confusion value
+  bitType mainKey;
+  bitType key;
+  bool isKHC;
+  bool isDIAC;
+  bool do_trans; // handle the transpositions of this key too
+};
+
 set<bitType> fill_set( const string& file_name ){
   ifstream is( file_name );
   if ( !is ){
@@ -761,7 +1056,7 @@ set<bitType> fill_set( const string& file_name ){
 }
 
 map<bitType,set<UnicodeString>> fill_hashmap( istream& is,
-					      const map<UnicodeString,size_t>& freq_map ){
+					      const ticcl::lexicon& lexicon ){
   map<bitType,set<UnicodeString>> result;
   UnicodeString line;
   while ( TiCC::getline( is, line ) ){
@@ -779,8 +1074,7 @@ map<bitType,set<UnicodeString>> fill_hashmap( istream& is,
       else {
 	bitType key = TiCC::stringTo<bitType>( v1[0] );
 	for ( size_t i=0; i < v2.size(); ++i ){
-	  auto it = freq_map.find( v2[i] );
-	  if ( it != freq_map.end() ){
+	  if ( lexicon.find( v2[i] ) != ticcl::word_table::npos ){
 	    // only store words from the .clean lexicon
 	    result[key].insert( v2[i] );
 	  }
@@ -796,12 +1090,35 @@ map<bitType,set<UnicodeString>> fill_hashmap( istream& is,
   return result;
 }
 
+map<bitType,set<UnicodeString>> fill_hashmap( const ticcl::anahash_file& ana,
+					      const ticcl::lexicon& lexicon ){
+  // the same as above, but from a memory mapped binary anagram hash file
+  map<bitType,set<UnicodeString>> result;
+  for ( size_t i=0; i < ana.size(); ++i ){
+    const bitType key = ana.hash_at( i );
+    for ( size_t j=0; j < ana.word_count( i ); ++j ){
+      UnicodeString word = ana.word( i, j );
+      if ( lexicon.find( word ) != ticcl::word_table::npos ){
+	// only store words from the .clean lexicon
+	result[key].insert( word );
+      }
+      else {
+	if ( verbose > 1 ){
+	  cerr << "skip hash for " << word << " (not in lexicon)" << endl;
+	}
+      }
+    }
+  }
+  return result;
+}
+
 int main( int argc, char **argv ){
   TiCC::CL_Options opts;
   try {
     opts.add_short_options( "vVho:t:" );
     opts.add_long_options( "diac:,hist:,nohld,artifrq:,LD:,hash:,clean:,alph:,"
-			   "index:,help,version,threads:,follow:,low:,high:" );
+			   "index:,help,version,threads:,follow:,low:,high:,"
+			   "maxmem:" );
     opts.init( argc, argv );
   }
   catch( TiCC::OptionError& e ){
@@ -910,14 +1227,22 @@ int main( int argc, char **argv ){
       exit( EXIT_FAILURE );
     }
   }
+  size_t max_mem = 0;
+  if ( opts.extract( "maxmem", value ) ){
+    if ( !TiCC::stringTo(value,max_mem) ) {
+      cerr << progname << ": illegal value for --maxmem (" << value << ")" << endl;
+      exit( EXIT_FAILURE );
+    }
+    max_mem *= 1024*1024;
+  }
   value = "1";
   if ( !opts.extract( 't', value ) ){
     opts.extract( "threads", value );
   }
+  int numThreads = 1;
 #ifdef HAVE_OPENMP
-  int numThreads;
   if ( TiCC::lowercase(value) == "max" ){
-    numThreads = omp_get_max_threads() - 2;
+    numThreads = max( omp_get_max_threads() - 2, 1 );
     omp_set_num_threads( numThreads );
     cout << "running on " << numThreads << " threads." << endl;
   }
@@ -926,6 +1251,7 @@ int main( int argc, char **argv ){
       cerr << "illegal value for -t (" << value << ")" << endl;
       exit( EXIT_FAILURE );
     }
+    numThreads = max( numThreads, 1 );
     omp_set_num_threads( numThreads );
     cout << "running on " << numThreads << " threads." << endl;
   }
@@ -962,51 +1288,75 @@ int main( int argc, char **argv ){
     ticcl::fillAlphabet( lexicon, alphabet );
     cout << progname << ": read " << alphabet.size() << " letters with frequencies" << endl;
   }
-  ifstream f_stream( frequency_file  );
-  if ( !f_stream ){
-    cerr << progname << ": problem opening " << frequency_file << endl;
-    exit(EXIT_FAILURE);
-  }
-  cout << progname << ": reading clean file: " << frequency_file << endl;
-  map<UnicodeString, size_t> freqMap;
-  map<UnicodeString, size_t> low_freqMap;
-  UnicodeString line;
+  ticcl::lexicon lexicon;
   size_t ign = 0;
   size_t skipped = 0;
-  while ( TiCC::getline( f_stream, line ) ){
-    vector<UnicodeString> v1 = TiCC::split( line );
-    if ( v1.size() != 2 ){
-      ++ign;
-      continue;
+  auto add_clean = [&]( const UnicodeString& ls, size_t freq ){
+    if ( low_limit > 0 && ls.length() < low_limit ){
+      ++skipped;
+      return;
+    }
+    if ( high_limit > 0 && ls.length() > high_limit ){
+      ++skipped;
+      return;
+    }
+    uint32_t id = lexicon.add( ls );
+    lexicon.set_freq( id, freq );
+    uint32_t low = lexicon.low_id( id );
+    size_t low_freq = lexicon.low_freq( low );
+    if ( freq >= artifreq ){
+      // make sure that the artifrq is counted only once!
+      if ( low_freq == 0 ){
+	low_freq = freq;
+      }
+      else {
+	low_freq += freq-artifreq;
+      }
     }
     else {
-      UnicodeString ls = v1[0];
-      if ( low_limit > 0 && ls.length() < low_limit ){
-	++skipped;
+      low_freq += freq;
+    }
+    lexicon.set_low_freq( low, low_freq );
+  };
+  if ( ticcl::is_vocab_file( frequency_file ) ){
+    cout << progname << ": reading clean vocabulary: " << frequency_file
+	 << endl;
+    ticcl::word_table vocab;
+    try {
+      vocab.open( frequency_file );
+    }
+    catch ( const exception& e ){
+      cerr << progname << ": " << e.what() << endl;
+      exit(EXIT_FAILURE);
+    }
+    for ( uint32_t id=0; id < vocab.size(); ++id ){
+      UnicodeString word = vocab.word( id );
+      if ( word.isEmpty() || TiCC::split( word ).size() != 1 ){
+	// like a line in the .clean file that doesn't split in 2
+	++ign;
 	continue;
       }
-      if ( high_limit > 0 && ls.length() > high_limit ){
-	++skipped;
+      add_clean( word, vocab.count( id ) );
+    }
+  }
+  else {
+    ifstream f_stream( frequency_file  );
+    if ( !f_stream ){
+      cerr << progname << ": problem opening " << frequency_file << endl;
+      exit(EXIT_FAILURE);
+    }
+    cout << progname << ": reading clean file: " << frequency_file << endl;
+    UnicodeString line;
+    while ( TiCC::getline( f_stream, line ) ){
+      vector<UnicodeString> v1 = TiCC::split( line );
+      if ( v1.size() != 2 ){
+	++ign;
 	continue;
       }
-      size_t freq = TiCC::stringTo<size_t>( v1[1] );
-      freqMap[ls] = freq;
-      ls.toLower();
-      if ( freq >= artifreq ){
-	// make sure that the artifrq is counted only once!
-	if ( low_freqMap[ls] == 0 ){
-	  low_freqMap[ls] = freq;
-	}
-	else {
-	  low_freqMap[ls] += freq-artifreq;
-	}
-      }
-      else {
-	low_freqMap[ls] +=freq;
-      }
+      add_clean( v1[0], TiCC::stringTo<size_t>( v1[1] ) );
     }
   }
-  cout << progname << ": read " << freqMap.size()
+  cout << progname << ": read " << lexicon.size()
        << " clean words with frequencies." << endl;
   if ( skipped > 0 ){
     cout << progname << ": skipped " << skipped << " out-of-band words."
@@ -1047,13 +1397,20 @@ int main( int argc, char **argv ){
     cerr << progname << ": problem opening: " << index_file << endl;
     exit(EXIT_FAILURE);
   }
-  ifstream anaf( anahash_file );
-  if ( !anaf ){
-    cerr << progname << ": problem opening anagram hashes file: "
-	 << anahash_file << endl;
-    exit(EXIT_FAILURE);
+  map<bitType,set<UnicodeString> > hashMap;
+  if ( ticcl::is_anahash_bin( anahash_file ) ){
+    ticcl::anahash_file anaf( anahash_file );
+    hashMap = fill_hashmap( anaf, lexicon );
+  }
+  else {
+    ifstream anaf( anahash_file );
+    if ( !anaf ){
+      cerr << progname << ": problem opening anagram hashes file: "
+	   << anahash_file << endl;
+      exit(EXIT_FAILURE);
+    }
+    hashMap = fill_hashmap( anaf, lexicon );
   }
-  map<bitType,set<UnicodeString> > hashMap = fill_hashmap( anaf, freqMap );
   cout << progname << ": read " << hashMap.size() << " hash values" << endl;
 
   size_t count=0;
@@ -1065,138 +1422,227 @@ int main( int argc, char **argv ){
   size_t line_nr = 0;
   int err_cnt = 0;
 
-  size_t file_lines = 0;
-  while ( TiCC::getline( indexf, line ) ){
-    ++file_lines;
-  }
-  if ( file_lines == 0 ){
-    cerr << "the indexfile: '" << index_file
-	 << "' is empty! No further processing possible." << endl;
-    exit( EXIT_FAILURE );
-  }
-  cout << progname << ": " << file_lines << " character confusion values to be read.\n\t\tWe indicate progress by printing a dot for every 1000 confusion values processed" << endl;
-  indexf.clear();
-  indexf.seekg( 0 );
-  while ( TiCC::getline( indexf, line ) ){
-    if ( err_cnt > 9 ){
-      cerr << progname << ": FATAL ERROR: too many problems in indexfile: "
-	   << index_file << " terminated" << endl;
-      exit( EXIT_FAILURE);
+  auto handle_item = [&]( const work_item& item ){
+    // compare the words of one anagram value with those of the value
+    // at distance item.mainKey. Runs in a task, so everything it
+    // stores is guarded by the critical sections in the helpers
+    const bitType mainKey = item.mainKey;
+    const bitType key = item.key;
+    const bool isKHC = item.isKHC;
+    const bool isDIAC = item.isDIAC;
+    auto sit1 = hashMap.find(key);
+    if ( sit1 == hashMap.end() ){
+      if ( verbose > 1 ){
+#pragma omp critical (debugout)
+	cerr << progname << ": WARNING: found a key '" << key
+	     << "' in the input that isn't present in the hashes." << endl;
+      }
+      return;
     }
-    ++line_nr;
     if ( verbose > 1 ){
-      cerr << "examine " << line << endl;
+#pragma omp critical (debugout)
+      cout << "bekijk key1 " << key << endl;
     }
-    line = line.trim();
-    if ( line.isEmpty() ){
-      continue;
+    if ( item.do_trans ){
+      handleTranspositions( sit1->second,
+			    key,
+			    lexicon, alphabet,
+			    dis_map, dis_count, ngram_count,
+			    artifreq, low_limit, isKHC, noKHCld, isDIAC,
+			    record_store );
     }
-    vector<UnicodeString> parts = TiCC::split_at( line, "#" );
-    if ( parts.size() != 2 ){
-      cerr << progname << ": ERROR in line " << line_nr
-	   << " of the indexfile: unable to split in 2 parts at #"
-	   << endl << "line was" << endl << line << endl;
-      ++err_cnt;
+    auto sit2 = hashMap.find(mainKey+key);
+    if ( sit2 == hashMap.end() ){
+      if ( verbose > 4 ){
+#pragma omp critical (debugout)
+	cerr << progname << ": WARNING: found a key '" << key
+	     << "' in the input that, when added to '" << mainKey
+	     << "' isn't present in the hashes." << endl;
+      }
+      return;
     }
-    else {
-      UnicodeString key_s = parts[0];
-      if ( ++count % 1000 == 0 ){
-	cout << ".";
-	cout.flush();
-	if ( count % 50000 == 0 ){
-	  cout << endl << count << endl;;
+    if ( verbose > 1 ){
+#pragma omp critical (debugout)
+      cout << "bekijk key2 " << mainKey + key << endl;
+    }
+    compareSets( LDvalue, mainKey, key,
+		 sit1->second, sit2->second,
+		 lexicon, alphabet,
+		 dis_map, dis_count, ngram_count,
+		 artifreq, low_limit, isKHC, noKHCld, isDIAC,
+		 record_store );
+  };
+
+  // the reader below hands out the (mainKey,key) pairs of many index
+  // entries in chunks, as tasks. So the workers are kept busy across
+  // entries, short ones included, while the reader proceeds
+  const size_t chunk_size = 64;
+  const size_t max_pending = 16 * numThreads;
+  vector<work_item> batch;
+  size_t pending = 0;
+  vector<string> record_runs;
+  vector<string> ambi_runs;
+  auto submit = [&](){
+    if ( batch.empty() ){
+      return;
+    }
+    vector<work_item> *todo = new vector<work_item>();
+    todo->swap( batch );
+    // the task would get its own copy of a captured variable, so it
+    // updates the shared counter through a pointer
+    size_t *in_flight = &pending;
+#pragma omp atomic
+    ++pending;
+#pragma omp task firstprivate( todo, in_flight ) if( numThreads > 1 )
+    {
+      for ( const auto& item : *todo ){
+	handle_item( item );
+      }
+      delete todo;
+#pragma omp atomic
+      --(*in_flight);
+    }
+    // don't let the reader run too far ahead
+    while ( true ){
+      size_t now;
+#pragma omp atomic read
+      now = pending;
+      if ( now <= max_pending ){
+	break;
+      }
+#pragma omp taskyield
+    }
+  };
+  auto queue_entry = [&]( bitType mainKey, const vector<bitType>& keys ){
+    if ( ++count % 1000 == 0 ){
+      cout << ".";
+      cout.flush();
+      if ( count % 50000 == 0 ){
+	cout << endl << count << endl;;
+      }
+    }
+    work_item item;
+    item.mainKey = mainKey;
+    item.isKHC = histSet.find( mainKey ) != histSet.end();
+    item.isDIAC = diaSet.find( mainKey ) != diaSet.end();
+    for ( const auto& key : keys ){
+      item.key = key;
+      // decided here, in index order, so the transpositions of a key are
+      // always handled with the flags of the first entry containing it
+      item.do_trans = false;
+      if ( LDvalue >= 2 ){
+	auto it = hashMap.find( key );
+	if ( it != hashMap.end()
+	     && it->second.size() > 0 ){
+	  item.do_trans = handledTrans.insert( key ).second;
 	}
       }
-      UnicodeString rest = parts[1];
-      if ( verbose > 1 ){
-	cerr << "extract parts from " << rest << endl;
+      batch.push_back( item );
+      if ( batch.size() >= chunk_size ){
+	submit();
       }
-      parts = TiCC::split_at( rest, "," );
-      if ( parts.size() < 1 ){
-	cerr << progname << ": ERROR in line " << line_nr
-	     << " of indexfile: unable to split in parts separated by ','"
-	     << endl << "line was" << endl << line << endl;
-	++err_cnt;
+    }
+    if ( max_mem > 0 ){
+      size_t used;
+#pragma omp atomic read
+      used = store_bytes;
+      if ( used > max_mem ){
+	submit();
+#pragma omp taskwait
+	spill_results( record_store, dis_map, outFile, ambiFile,
+		       record_runs, ambi_runs );
       }
-      else {
-	bitType mainKey = TiCC::stringTo<bitType>(key_s);
-	bool isKHC = false;
-	if ( histSet.find( mainKey ) != histSet.end() ){
-	  isKHC = true;
+    }
+  };
+
+  bitType mainKey;
+  vector<bitType> keys;
+#pragma omp parallel
+#pragma omp single
+  {
+    if ( ticcl::is_index_bin( index_file ) ){
+      // the binary index has its size in the header and needs no parsing
+      ticcl::index_reader index( indexf );
+      if ( index.size() == 0 ){
+	cerr << "the indexfile: '" << index_file
+	     << "' is empty! No further processing possible." << endl;
+	exit( EXIT_FAILURE );
+      }
+      cout << progname << ": " << index.size() << " character confusion values to be read.\n\t\tWe indicate progress by printing a dot for every 1000 confusion values processed" << endl;
+      while ( index.next( mainKey, keys ) ){
+	queue_entry( mainKey, keys );
+      }
+    }
+    else {
+      cout << progname << ": reading character confusion values from: " << index_file << "\n\t\tWe indicate progress by printing a dot for every 1000 confusion values processed" << endl;
+      UnicodeString line;
+      while ( TiCC::getline( indexf, line ) ){
+	if ( err_cnt > 9 ){
+	  cerr << progname << ": FATAL ERROR: too many problems in indexfile: "
+	       << index_file << " terminated" << endl;
+	  exit( EXIT_FAILURE);
 	}
-	bool isDIAC = false;
-	if ( diaSet.find( mainKey ) != diaSet.end() ){
-	  isDIAC = true;
+	++line_nr;
+	if ( verbose > 1 ){
+	  cerr << "examine " << line << endl;
 	}
-#pragma omp parallel for schedule(dynamic,1)
-	for ( size_t i=0; i < parts.size(); ++i ){
-	  UnicodeString keyS = parts[i];
-	  bitType key = TiCC::stringTo<bitType>(keyS);
-	  auto sit1 = hashMap.find(key);
-	  if ( sit1 == hashMap.end() ){
-	    if ( verbose > 1 ){
-#pragma omp critical (debugout)
-	      cerr << progname << ": WARNING: found a key '" << key
-		   << "' in the input that isn't present in the hashes." << endl;
-	    }
-	    continue;
-	  }
+	line = line.trim();
+	if ( line.isEmpty() ){
+	  continue;
+	}
+	vector<UnicodeString> parts = TiCC::split_at( line, "#" );
+	if ( parts.size() != 2 ){
+	  cerr << progname << ": ERROR in line " << line_nr
+	       << " of the indexfile: unable to split in 2 parts at #"
+	       << endl << "line was" << endl << line << endl;
+	  ++err_cnt;
+	}
+	else {
+	  UnicodeString key_s = parts[0];
+	  UnicodeString rest = parts[1];
 	  if ( verbose > 1 ){
-#pragma omp critical (debugout)
-	    cout << "bekijk key1 " << key << endl;
+	    cerr << "extract parts from " << rest << endl;
 	  }
-	  if ( sit1->second.size() > 0
-	       && LDvalue >= 2 ){
-	    bool do_trans = false;
-#pragma omp critical (debugout)
-	    {
-	      auto res = handledTrans.insert( key );
-	      do_trans = res.second == true;
-	    }
-	    if ( do_trans ){
-	      handleTranspositions( sit1->second,
-				    key,
-				    freqMap, low_freqMap, alphabet,
-				    dis_map, dis_count, ngram_count,
-				    artifreq, low_limit, isKHC, noKHCld, isDIAC,
-				    record_store );
-	    }
+	  parts = TiCC::split_at( rest, "," );
+	  if ( parts.size() < 1 ){
+	    cerr << progname << ": ERROR in line " << line_nr
+		 << " of indexfile: unable to split in parts separated by ','"
+		 << endl << "line was" << endl << line << endl;
+	    ++err_cnt;
 	  }
-	  auto sit2 = hashMap.find(mainKey+key);
-	  if ( sit2 == hashMap.end() ){
-	    if ( verbose > 4 ){
-#pragma omp critical (debugout)
-	      cerr << progname << ": WARNING: found a key '" << key
-		   << "' in the input that, when added to '" << mainKey
-		   << "' isn't present in the hashes." << endl;
+	  else {
+	    mainKey = TiCC::stringTo<bitType>(key_s);
+	    keys.clear();
+	    for ( const auto& p : parts ){
+	      keys.push_back( TiCC::stringTo<bitType>(p) );
 	    }
-	    continue;
-	  }
-	  if ( verbose > 1 ){
-#pragma omp critical (debugout)
-	    cout << "bekijk key2 " << mainKey + key << endl;
+	    queue_entry( mainKey, keys );
 	  }
-	  compareSets( LDvalue, mainKey, key,
-		       sit1->second, sit2->second,
-		       freqMap, low_freqMap, alphabet,
-		       dis_map, dis_count, ngram_count,
-		       artifreq, low_limit, isKHC, noKHCld, isDIAC,
-		       record_store );
 	}
       }
+      if ( line_nr == 0 ){
+	cerr << "the indexfile: '" << index_file
+	     << "' is empty! No further processing possible." << endl;
+	exit( EXIT_FAILURE );
+      }
     }
-  }
+    submit();
+  } // the barrier at the end of single waits for all remaining tasks
   cout << endl << "creating .short file: " << shortFile << endl;
   ofstream shortf( shortFile );
-  add_short( shortf, dis_count, freqMap, low_freqMap, LDvalue, artifreq );
+  add_short( shortf, dis_count, lexicon, LDvalue, artifreq );
+  if ( !record_runs.empty() ){
+    // spill the rest too, so everything can be merged from the runs
+    spill_results( record_store, dis_map, outFile, ambiFile,
+		   record_runs, ambi_runs );
+  }
   cout << endl << "creating .ambi file: " << ambiFile << endl;
   ofstream amb( ambiFile );
-  for ( const auto& [word,ambi_set] : dis_map ){
-    amb << word << "#";
-    for ( const auto& val : ambi_set ){
-      amb << val << "#";
-    }
-    amb << endl;
+  if ( ambi_runs.empty() ){
+    write_ambi( amb, dis_map );
+  }
+  else {
+    merge_ambi( amb, ambi_runs );
   }
   map<UnicodeString,unsigned int> low_ngramcount;
   for ( const auto& [word,cnt] : ngram_count ){
@@ -1204,24 +1650,35 @@ int main( int argc, char **argv ){
     lv.toLower();
     low_ngramcount[lv] += cnt;
   }
-  for ( const auto& [word,dummy] : ngram_count ){
-    if ( record_store.find( word ) != record_store.end() ){
-      UnicodeString lv = word;
-      lv.toLower();
-      assert( low_ngramcount.find( lv ) != low_ngramcount.end() );
-      record_store.find(word)->second.ngram_point += low_ngramcount[lv];
-    }
-    else {
-      // Ok, our data seems to be incomplete
-      // that is not our problem, so ignore
-      if ( verbose > 2 ){
-	cerr << "ignoring " << word << endl;
+  ofstream os( outFile );
+  if ( record_runs.empty() ){
+    for ( const auto& [word,dummy] : ngram_count ){
+      if ( record_store.find( word ) != record_store.end() ){
+	UnicodeString lv = word;
+	lv.toLower();
+	assert( low_ngramcount.find( lv ) != low_ngramcount.end() );
+	record_store.find(word)->second.ngram_point += low_ngramcount[lv];
+      }
+      else {
+	// Ok, our data seems to be incomplete
+	// that is not our problem, so ignore
+	if ( verbose > 2 ){
+	  cerr << "ignoring " << word << endl;
+	}
       }
     }
+    write_records( os, record_store );
   }
-  ofstream os( outFile );
-  for ( const auto& r : record_store ){
-    os << r.second.toString() << endl;
+  else {
+    cout << progname << ": merging " << record_runs.size()
+	 << " run files" << endl;
+    merge_records( os, record_runs, ngram_count, low_ngramcount );
+    for ( const auto& name : record_runs ){
+      remove( name.c_str() );
+    }
+    for ( const auto& name : ambi_runs ){
+      remove( name.c_str() );
+    }
   }
   cout << progname << ": Done" << endl;
 }
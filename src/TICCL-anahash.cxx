@@ -31,6 +31,9 @@
 #include <map>
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 
 #include "ticcutils/StringOps.h"
 #include "ticcutils/FileUtils.h"
@@ -39,6 +42,9 @@
 #include "ticcl/ticcl_common.h"
 
 #include "config.h"
+#ifdef HAVE_OPENMP
+#include "omp.h"
+#endif
 
 using namespace	std;
 using namespace icu;
@@ -50,6 +56,7 @@ UnicodeString separator;
 bool do_list = false;
 bool do_merge = false;
 bool do_ngrams = false;
+bool do_bin = false;
 
 void create_output( ostream& os,
 		    const map<bitType, set<UnicodeString>>& anagrams ){
@@ -99,8 +106,14 @@ void usage( const string& name ){
   cerr << "\t\t values that have a lexical frequency < 'artifrq'. (default=0)" << endl;
   cerr << "\t\t for n-grams, only those n-grams are written where at least one" << endl;
   cerr << "\t\t of the composing parts does not have the lexical frequency artifrq. " << endl;
+  cerr << "\t--bin\t also write a binary, memory mappable, version of the" << endl;
+  cerr << "\t\t anagram hash file, named 'output_name'.bin" << endl;
   cerr << "\t--ngrams When the frequency file contains n-grams. (not necessary of equal arity)" << endl;
   cerr << "\t\t we split them into 1-grams and do a frequency lookup per part for the artifreq value." << endl;
+  cerr << "\t-t <threads> or --threads <threads> Number of threads to run on." << endl;
+  cerr << "\t\t\t If 'threads' has the value \"max\", the number of threads is set to a" << endl;
+  cerr << "\t\t\t reasonable value. (OMP_NUM_THREADS - 2). The output is the same" << endl;
+  cerr << "\t\t\t for every number of threads." << endl;
   cerr << "\t-V or --version\t show version " << endl;
   cerr << "\t-v\t verbose (not used yet) " << endl;
 }
@@ -108,7 +121,7 @@ void usage( const string& name ){
 void read_backgound( istream& is,
 		     map<bitType, set<UnicodeString>>& anagrams,
 		     map<UnicodeString,bitType>& merged,
-		     const map<UChar,bitType>& alphabet ){
+		     const ticcl::alphabet_table& alphabet ){
   UnicodeString line;
   while ( TiCC::getline( is, line ) ){
     vector<UnicodeString> v = TiCC::split_at( line, "\t" );
@@ -132,7 +145,7 @@ void read_data( istream& is,
 		map<bitType, set<UnicodeString>>& anagrams,
 		map<UnicodeString,bitType>& merged,
 		map<UnicodeString,bitType>& freq_list,
-		const map<UChar,bitType>& alphabet,
+		const ticcl::alphabet_table& alphabet,
 		ostream& os ){
   UnicodeString line;
   while ( TiCC::getline( is, line ) ){
@@ -162,52 +175,277 @@ void read_data( istream& is,
   }
 }
 
+// the parallel versions of read_data() and read_backgound(). The input
+// is read in blocks of lines, which are decoded, split and hashed in
+// parallel. The maps are built in shards, each holding a consecutive
+// range of keys, so they can be filled in parallel and finally be
+// concatenated without any comparisons.
+
+const size_t block_size = 100000;
+
+struct line_info {
+  UnicodeString orig;  // the word as is, or the whole line when it is bad
+  UnicodeString word;  // the word without ~ and #
+  bitType hash = 0;
+  bitType freq = 1;
+  bool ok = false;
+  string error;        // a problem converting the frequency
+};
+
+size_t read_block( istream& is, vector<string>& lines ){
+  lines.clear();
+  string line;
+  while ( lines.size() < block_size && getline( is, line ) ){
+    lines.push_back( line );
+  }
+  return lines.size();
+}
+
+void parse_block( const vector<string>& lines,
+		  vector<line_info>& infos,
+		  const ticcl::alphabet_table& alphabet,
+		  bool need_freq ){
+  infos.resize( lines.size() );
+#pragma omp parallel for schedule(static)
+  for ( size_t i=0; i < lines.size(); ++i ){
+    line_info& info = infos[i];
+    info = line_info();
+    UnicodeString line = TiCC::UnicodeFromUTF8( lines[i] );
+    vector<UnicodeString> v = TiCC::split_at( line, "\t" );
+    if ( !( v.size() == 1 || v.size() == 2 ) ){
+      info.orig = line;
+      continue;
+    }
+    info.ok = true;
+    info.orig = v[0];
+    info.word = filter_tilde_hashtag( v[0] );
+    info.hash = alphabet.hash( info.word );
+    if ( need_freq && v.size() == 2 ){
+      try {
+	info.freq = TiCC::stringTo<bitType>( v[1] );
+      }
+      catch( const exception& e ){
+	info.error = e.what();
+      }
+    }
+  }
+}
+
+size_t good_lines( const vector<line_info>& infos ){
+  // the number of lines before the first problem
+  for ( size_t i=0; i < infos.size(); ++i ){
+    if ( !infos[i].ok || !infos[i].error.empty() ){
+      return i;
+    }
+  }
+  return infos.size();
+}
+
+void bail_out( const line_info& info, const string& what ){
+  // stop in the same way as the sequential code does
+  if ( !info.ok ){
+    cerr << what << " in wrong format!" << endl;
+    cerr << "offending line: " << info.orig << endl;
+    exit(EXIT_FAILURE);
+  }
+  throw runtime_error( info.error );
+}
+
+template <typename Key>
+class key_ranges {
+  // splits the keys in n consecutive ranges, on the quantiles of a sample
+public:
+  void init( vector<Key> sample, size_t n ){
+    bounds.clear();
+    sort( sample.begin(), sample.end() );
+    for ( size_t r=1; r < n; ++r ){
+      bounds.push_back( sample.empty() ? Key() : sample[r*sample.size()/n] );
+    }
+  }
+  bool empty() const { return bounds.empty(); };
+  bool in_range( const Key& k, size_t r ) const {
+    return ( r == 0 || !( k < bounds[r-1] ) )
+      && ( r == bounds.size() || k < bounds[r] );
+  };
+private:
+  vector<Key> bounds;
+};
+
+template <typename Map>
+void append_shards( vector<Map>& shards, Map& result ){
+  // the shards hold consecutive key ranges, so every node goes to the end
+  for ( auto& shard : shards ){
+    while ( !shard.empty() ){
+      result.insert( result.end(), shard.extract( shard.begin() ) );
+    }
+  }
+}
+
+void read_data_parallel( istream& is,
+			 map<bitType, set<UnicodeString>>& anagrams,
+			 map<UnicodeString,bitType>& merged,
+			 map<UnicodeString,bitType>& freq_list,
+			 const ticcl::alphabet_table& alphabet,
+			 ostream& os,
+			 size_t threads ){
+  vector<map<bitType, set<UnicodeString>>> ana_shards( threads );
+  vector<map<UnicodeString,bitType>> freq_shards( threads );
+  vector<map<UnicodeString,bitType>> merge_shards( threads );
+  key_ranges<bitType> hash_ranges;
+  key_ranges<UnicodeString> word_ranges;
+  key_ranges<UnicodeString> orig_ranges;
+  const bool fill_merged = do_merge && artifreq > 0;
+  vector<string> lines;
+  vector<line_info> infos;
+  while ( read_block( is, lines ) > 0 ){
+    parse_block( lines, infos, alphabet, !do_list );
+    const size_t good = good_lines( infos );
+    if ( do_list ){
+      for ( size_t i=0; i < good; ++i ){
+	os << infos[i].orig << "\t" << infos[i].hash << endl;
+      }
+    }
+    else {
+      if ( hash_ranges.empty() && threads > 1 ){
+	// take the ranges from the first block
+	vector<bitType> hashes;
+	vector<UnicodeString> words;
+	vector<UnicodeString> origs;
+	for ( size_t i=0; i < good; ++i ){
+	  hashes.push_back( infos[i].hash );
+	  words.push_back( infos[i].word );
+	  origs.push_back( infos[i].orig );
+	}
+	hash_ranges.init( hashes, threads );
+	word_ranges.init( words, threads );
+	orig_ranges.init( origs, threads );
+      }
+      // one task per shard of each map
+#pragma omp parallel for schedule(dynamic)
+      for ( size_t t=0; t < 3*threads; ++t ){
+	const size_t r = t % threads;
+	if ( t < threads ){
+	  for ( size_t i=0; i < good; ++i ){
+	    if ( hash_ranges.in_range( infos[i].hash, r ) ){
+	      ana_shards[r][infos[i].hash].insert( infos[i].word );
+	    }
+	  }
+	}
+	else if ( t < 2*threads ){
+	  for ( size_t i=0; i < good; ++i ){
+	    if ( word_ranges.in_range( infos[i].word, r ) ){
+	      freq_shards[r][infos[i].word] = infos[i].freq;
+	    }
+	  }
+	}
+	else if ( fill_merged ){
+	  for ( size_t i=0; i < good; ++i ){
+	    if ( orig_ranges.in_range( infos[i].orig, r ) ){
+	      merge_shards[r][infos[i].orig] = infos[i].freq;
+	    }
+	  }
+	}
+      }
+    }
+    if ( good < infos.size() ){
+      bail_out( infos[good], "frequency file" );
+    }
+  }
+  append_shards( ana_shards, anagrams );
+  append_shards( freq_shards, freq_list );
+  append_shards( merge_shards, merged );
+}
+
+void read_backgound_parallel( istream& is,
+			      map<bitType, set<UnicodeString>>& anagrams,
+			      map<UnicodeString,bitType>& merged,
+			      const ticcl::alphabet_table& alphabet ){
+  // only the parsing and hashing is done in parallel here
+  vector<string> lines;
+  vector<line_info> infos;
+  while ( read_block( is, lines ) > 0 ){
+    parse_block( lines, infos, alphabet, true );
+    const size_t good = good_lines( infos );
+    for ( size_t i=0; i < good; ++i ){
+      anagrams[infos[i].hash].insert( infos[i].word );
+      merged[infos[i].orig] += infos[i].freq;
+    }
+    if ( good < infos.size() ){
+      bail_out( infos[good], "background file" );
+    }
+  }
+}
+
 map<bitType, set<UnicodeString>>
 extract_foci( const map<UnicodeString,bitType>& freq_list,
-	      const map<UChar,bitType>& alphabet ){
+	      const ticcl::alphabet_table& alphabet ){
+  // the entries of freq_list in order, so we can do the lookups with a
+  // binary search on an index, from several threads
+  using freq_entry = pair<const UnicodeString,bitType>;
+  vector<const freq_entry*> entries;
+  entries.reserve( freq_list.size() );
+  for ( const auto& entry : freq_list ){
+    entries.push_back( &entry );
+  }
+  auto index_of = [&entries]( const UnicodeString& w ){
+    auto it = lower_bound( entries.begin(), entries.end(), w,
+			   []( const freq_entry *e, const UnicodeString& v ){
+			     return e->first < v;
+			   } );
+    if ( it != entries.end() && (*it)->first == w ){
+      return size_t( it - entries.begin() );
+    }
+    return entries.size();
+  };
+  // for all words below artifreq: is the lowercased word absent OR below
+  // artifreq too? This replaces a toLower() on every lookup of a part.
+  vector<char> low_ok( entries.size(), 0 );
+#pragma omp parallel for schedule(dynamic,1024)
+  for ( size_t i=0; i < entries.size(); ++i ){
+    if ( entries[i]->second < artifreq ){
+      UnicodeString l_word = entries[i]->first;
+      l_word.toLower();
+      const size_t l = index_of( l_word );
+      low_ok[i] = ( l == entries.size() || entries[l]->second < artifreq );
+    }
+  }
   map<bitType, set<UnicodeString>> foci;
-  for ( const auto& [val,freq] : freq_list ){
-    UnicodeString word = val;
-    bitType h = ticcl::hash( word, alphabet );
-    if ( do_ngrams ){
-      vector<UnicodeString> parts = TiCC::split_at( word, separator );
-      if ( parts.size() > 0 ){
-	// we have an -n-gram
-	bool accept = false;
+#pragma omp parallel
+  {
+    map<bitType, set<UnicodeString>> local_foci;
+#pragma omp for schedule(dynamic,1024) nowait
+    for ( size_t i=0; i < entries.size(); ++i ){
+      const UnicodeString& word = entries[i]->first;
+      bool accept = false;
+      if ( do_ngrams ){
 	// we split the ngram to see if it is worth adding it to
 	// the foci list.
 	//    - NOT if no part is in the input
 	//    - NOT if all parts are know words.
+	vector<UnicodeString> parts = TiCC::split_at( word, separator );
 	for ( auto const& part: parts ){
-	  const auto u_it = freq_list.find( part );
-	  if ( u_it != freq_list.end()
-	       && u_it->second < artifreq ){
-	    // so this part IS present in the input, but not in the background
-	    UnicodeString l_part = part;
-	    l_part.toLower();
-	    const auto l_it = freq_list.find(l_part);
-	    if ( l_it == freq_list.end()
-		 || l_it->second < artifreq ){
-	      // the lowercase part is NOT present OR NOT the background
-	      accept = true;
-	    }
+	  const size_t p = index_of( part );
+	  if ( p < entries.size() && low_ok[p] ){
+	    // so this part IS present in the input, but not in the
+	    // background. And the lowercase part is NOT present OR NOT in
+	    // the background
+	    accept = true;
+	    break;
 	  }
 	}
-	if ( accept ){
-	  word.toLower();
-	  foci[h].insert( word );
-	}
       }
-    }
-    else {
-      if ( freq < artifreq ){
-	word.toLower();
-	const auto l_it = freq_list.find(word);
-	if ( l_it == freq_list.end()
-	     || l_it->second < artifreq ){
-	  foci[h].insert(word);
-	}
+      else {
+	accept = low_ok[i];
       }
+      if ( accept ){
+	UnicodeString l_word = word;
+	l_word.toLower();
+	local_foci[alphabet.hash( word )].insert( l_word );
+      }
+    }
+#pragma omp critical (foci)
+    for ( auto& [h,words] : local_foci ){
+      foci[h].merge( words );
     }
   }
   return foci;
@@ -216,8 +454,8 @@ extract_foci( const map<UnicodeString,bitType>& freq_list,
 int main( int argc, const char *argv[] ){
   TiCC::CL_Options opts;
   try {
-    opts.add_short_options( "vVho:" );
-    opts.add_long_options( "alph:,background:,artifrq:,clip:,help,version,ngrams,list,separator:" );
+    opts.add_short_options( "vVho:t:" );
+    opts.add_long_options( "alph:,background:,artifrq:,clip:,help,version,ngrams,list,separator:,bin,threads:" );
     opts.init( argc, argv );
   }
   catch( TiCC::OptionError& e ){
@@ -262,7 +500,35 @@ int main( int argc, const char *argv[] ){
       exit( EXIT_FAILURE );
     }
   }
+  value = "1";
+  if ( !opts.extract( 't', value ) ){
+    opts.extract( "threads", value );
+  }
+  int numThreads = 1;
+#ifdef HAVE_OPENMP
+  if ( TiCC::lowercase(value) == "max" ){
+    numThreads = max( omp_get_max_threads() - 2, 1 );
+  }
+  else {
+    if ( !TiCC::stringTo(value,numThreads) ) {
+      cerr << "illegal value for -t (" << value << ")" << endl;
+      exit( EXIT_FAILURE );
+    }
+    numThreads = max( numThreads, 1 );
+  }
+  omp_set_num_threads( numThreads );
+  if ( numThreads > 1 ){
+    cout << "running on " << numThreads << " threads." << endl;
+  }
+#else
+  if ( value != "1" ){
+    cerr << "unable to set number of threads!.\nNo OpenMP support available!"
+	 <<endl;
+    exit(EXIT_FAILURE);
+  }
+#endif
   do_ngrams = opts.extract( "ngrams" );
+  do_bin = opts.extract( "bin" );
   string out_file_name;
   opts.extract( "o", out_file_name );
   if ( !opts.empty() ){
@@ -321,13 +587,14 @@ int main( int argc, const char *argv[] ){
     }
   }
 
-  map<UChar,bitType> alphabet;
+  map<UChar,bitType> alphabet_map;
   cout << "reading alphabet file: " << alphafile << endl;
   ifstream as( alphafile );
-  if ( !ticcl::fillAlphabet( as, alphabet, clip ) ){
+  if ( !ticcl::fillAlphabet( as, alphabet_map, clip ) ){
     cerr << "serious problems reading alphabet file: " << alphafile << endl;
     exit(EXIT_FAILURE);
   }
+  const ticcl::alphabet_table alphabet( alphabet_map );
   cout << "finished reading alphabet. (" << alphabet.size() << " characters)"
        << endl;
   string foci_file_name = file_name;
@@ -340,6 +607,10 @@ int main( int argc, const char *argv[] ){
       cerr << "option --background not supported for --list" << endl;
       exit( EXIT_FAILURE);
     }
+    if ( do_bin ){
+      cerr << "option --bin not supported for --list" << endl;
+      exit( EXIT_FAILURE);
+    }
     if ( !TiCC::createPath( out_file_name ) ){
       cerr << "unable to open output file: " << out_file_name << endl;
       exit(EXIT_FAILURE);
@@ -371,12 +642,23 @@ int main( int argc, const char *argv[] ){
   cout << "start hashing from the corpus frequency file: " << file_name << endl;
   ifstream is( file_name );
   ofstream out_stream( out_file_name );
-  read_data( is,
-	     anagrams,
-	     merged,
-	     freq_list,
-	     alphabet,
-	     out_stream );
+  if ( numThreads > 1 ){
+    read_data_parallel( is,
+			anagrams,
+			merged,
+			freq_list,
+			alphabet,
+			out_stream,
+			numThreads );
+  }
+  else {
+    read_data( is,
+	       anagrams,
+	       merged,
+	       freq_list,
+	       alphabet,
+	       out_stream );
+  }
 
   if ( do_list ){
     cout << "created a list file: " << out_file_name << endl;
@@ -392,7 +674,12 @@ int main( int argc, const char *argv[] ){
   if ( do_merge ){
     cerr << "merge background corpus: " << backfile << endl;
     ifstream bs( backfile );
-    read_backgound( bs, anagrams, merged, alphabet );
+    if ( numThreads > 1 ){
+      read_backgound_parallel( bs, anagrams, merged, alphabet );
+    }
+    else {
+      read_backgound( bs, anagrams, merged, alphabet );
+    }
     string merge_file_name = file_name + ".merged";
     ofstream ms( merge_file_name );
     for ( const auto& [word,freq] : merged ){
@@ -404,5 +691,15 @@ int main( int argc, const char *argv[] ){
 
   cout << "generating output file: " << out_file_name << endl;
   create_output( out_stream, anagrams );
+  if ( do_bin ){
+    string bin_file_name = out_file_name + ".bin";
+    cout << "generating binary output file: " << bin_file_name << endl;
+    ofstream bs( bin_file_name, ios::binary );
+    if ( !bs ){
+      cerr << "unable to open binary output file: " << bin_file_name << endl;
+      exit(EXIT_FAILURE);
+    }
+    ticcl::write_anahash_bin( bs, anagrams );
+  }
   cout << "done!" << endl;
 }
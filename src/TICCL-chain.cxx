@@ -64,6 +64,7 @@ unsigned int ld( const UnicodeString& in1,
 }
 
 map<UChar,bitType> alphabet;
+ticcl::alphabet_table alpha_table;
 
 class chain_class {
 public:
@@ -72,24 +73,48 @@ public:
   bool fill( const UnicodeString&, bool );
   void debug_info( ostream& );
   void output( const string& );
-  UnicodeString top_head( const UnicodeString& );
+  uint32_t top_head( uint32_t );
   void final_merge();
  private:
-  map<UnicodeString,UnicodeString> heads;
-  map<UnicodeString, set<UnicodeString>> table;
-  map<UnicodeString, size_t > var_freq;
+  uint32_t word_id( const UnicodeString& );
+  set<UnicodeString> as_words( const set<uint32_t>& ) const;
+  // all words get an ID, and the data per word is kept in vectors
+  // indexed by that ID
+  ticcl::word_table words;
+  vector<uint32_t> heads; // npos when a word has no head
+  vector<set<uint32_t>> table;
+  vector<size_t> var_freq;
+  vector<bool> processed;
   map<UnicodeString, UnicodeString> w_cc_conf;
-  set<UnicodeString> processed;
   int verbosity;
   bool caseless;
   bool cc_vals_present;
 };
 
-UnicodeString chain_class::top_head( const UnicodeString& candidate ){
-  UnicodeString result = heads[candidate];
-  if ( !result.isEmpty() ){
-    UnicodeString next = top_head( result );
-    if ( !next.isEmpty() ){
+uint32_t chain_class::word_id( const UnicodeString& word ){
+  uint32_t id = words.intern( word );
+  if ( id >= heads.size() ){
+    heads.resize( id+1, ticcl::word_table::npos );
+    table.resize( id+1 );
+    var_freq.resize( id+1, 0 );
+    processed.resize( id+1, false );
+  }
+  return id;
+}
+
+set<UnicodeString> chain_class::as_words( const set<uint32_t>& ids ) const {
+  set<UnicodeString> result;
+  for ( const auto id : ids ){
+    result.insert( words.word( id ) );
+  }
+  return result;
+}
+
+uint32_t chain_class::top_head( uint32_t candidate ){
+  uint32_t result = heads[candidate];
+  if ( result != ticcl::word_table::npos ){
+    uint32_t next = top_head( result );
+    if ( next != ticcl::word_table::npos ){
       result = next;
     }
   }
@@ -97,18 +122,21 @@ UnicodeString chain_class::top_head( const UnicodeString& candidate ){
 }
 
 void chain_class::final_merge(){
-  for ( auto& [word,word_set] : table ){
+  // visit the words in the same (alphabetical) order as before
+  for ( const auto word : words.sorted() ){
+    set<uint32_t>& word_set = table[word];
     if ( !word_set.empty() ){
       // for all entries that seem to be a 'head'
-      UnicodeString head = top_head( word );
+      uint32_t head = top_head( word );
       assert( head != word );
-      if ( !head.isEmpty() ){
+      if ( head != ticcl::word_table::npos ){
 	// so it has a higher head
 	if ( verbosity > 3 ){
-	  cerr << "merge: " << word << word_set << " into "
-	       << head << table[head] << endl;
+	  cerr << "merge: " << words.word(word) << as_words(word_set)
+	       << " into " << words.word(head) << as_words(table[head])
+	       << endl;
 	}
-	for ( const auto& s : word_set ){
+	for ( const auto s : word_set ){
 	  table[head].insert( s );
 	  heads[s] = head;
 	}
@@ -148,14 +176,15 @@ bool chain_class::fill( const UnicodeString& line, bool nounk ){
       exit(EXIT_FAILURE);
     }
     UnicodeString a_word = parts[0]; // a possibly correctable word
-    if ( processed.find(a_word) != processed.end() ){
+    uint32_t a_id = word_id( a_word );
+    if ( processed[a_id] ){
       // we have already seen this word. probably ranked with a clip >1
       // just ignore!
       //      cerr << "ignore extra entry for: " << a_word << endl;
       return true;
     }
     else {
-      processed.insert(a_word);
+      processed[a_id] = true;
       // so a new word with Correction Candidate
       size_t freq1 = TiCC::stringTo<size_t>(parts[1]);
       UnicodeString candidate = parts[2];
@@ -179,57 +208,60 @@ bool chain_class::fill( const UnicodeString& line, bool nounk ){
 	UnicodeString key = a_word+candidate;
 	w_cc_conf[key] = cc_val;
       }
-      var_freq[a_word] = freq1;
-      var_freq[candidate] = freq2;
+      uint32_t c_id = word_id( candidate );
+      var_freq[a_id] = freq1;
+      var_freq[c_id] = freq2;
       if ( verbosity > 3 ){
 	cerr << endl << "word=" << a_word << " CC=" << candidate << endl;
       }
-      UnicodeString head = heads[a_word];
-      if ( head.isEmpty() ){
+      uint32_t head = heads[a_id];
+      if ( head == ticcl::word_table::npos ){
 	// this word does not have a 'head' yet
 	if ( verbosity > 3 ){
 	  cerr << "word: " << a_word << " NOT in heads " << endl;
 	}
-	UnicodeString head2 = heads[candidate];
-	if ( head2.isEmpty() ){
+	uint32_t head2 = heads[c_id];
+	if ( head2 == ticcl::word_table::npos ){
 	  // the correction candidate also has no head
 	  // we add it as a new head for a_word, with a table
-	  heads[a_word] = candidate;
-	  table[candidate].insert( a_word );
+	  heads[a_id] = c_id;
+	  table[c_id].insert( a_id );
 	  if ( verbosity > 3 ){
 	    cerr << "candidate : " << candidate << " not in heads too." << endl;
 	    cerr << "add " << candidate << " to heads[" << a_word << "]" << endl;
 	    cerr << "add " << a_word << " to table of " << candidate
-		 << " ==> " << table[candidate] << endl;
+		 << " ==> " << as_words(table[c_id]) << endl;
 	  }
 	}
 	else {
 	  // the candidate knows its head already
 	  // add the word to the table of that head, and also register
 	  // the head as an (intermediate) head of a_word
-	  heads[a_word] = head2;
-	  table[head2].insert( a_word );
+	  heads[a_id] = head2;
+	  table[head2].insert( a_id );
 	  if ( verbosity > 3 ){
 	    cerr << "BUT: Candidate " << candidate << " has head: "
-		 << head2 << endl;
-	    cerr << "add " << a_word << " to table[" << head2 << "]"
-		 << " ==> " << table[head2] << endl;
-	    cerr << "AND add " << head2 << " as a head of " << a_word << endl;
+		 << words.word(head2) << endl;
+	    cerr << "add " << a_word << " to table[" << words.word(head2) << "]"
+		 << " ==> " << as_words(table[head2]) << endl;
+	    cerr << "AND add " << words.word(head2) << " as a head of "
+		 << a_word << endl;
 	  }
 	}
       }
       else {
 	// the word has a head
 	if ( verbosity > 3 ){
-	  cerr << "word: " << a_word << " IN heads " << head << endl;
+	  cerr << "word: " << a_word << " IN heads " << words.word(head)
+	       << endl;
 	}
-	auto const tit = table.find( head );
-	if ( tit != table.end() ){
+	const set<uint32_t>& head_set = table[head];
+	if ( !head_set.empty() ){
 	  // there MUST be some candidates registered for the head
 	  if ( verbosity > 3 ){
-	    cerr << "lookup " << a_word << " in " << tit->second << endl;
+	    cerr << "lookup " << a_word << " in " << as_words(head_set) << endl;
 	  }
-	  if ( tit->second.find( a_word ) == tit->second.end() ){
+	  if ( head_set.find( a_id ) == head_set.end() ){
 	    string msg = "Error: " + TiCC::UnicodeToUTF8(a_word)
 	      + " has a heads entry, but no table entry!";
 	    throw logic_error( msg );
@@ -251,29 +283,47 @@ bool chain_class::fill( const UnicodeString& line, bool nounk ){
 }
 
 void chain_class::debug_info( ostream& db ){
-  for ( const auto& [word,head] : heads ){
-    db << "head[" << word << "]=" << head << endl;
+  const vector<uint32_t> order = words.sorted();
+  for ( const auto word : order ){
+    db << "head[" << words.word(word) << "]=";
+    if ( heads[word] != ticcl::word_table::npos ){
+      db << words.word(heads[word]);
+    }
+    db << endl;
   }
-  for ( const auto& [word,word_set] : table ){
-    db << var_freq[word] << " " << word
-       << " " << word_set << endl;
+  for ( const auto word : order ){
+    if ( !table[word].empty() ){
+      db << var_freq[word] << " " << words.word(word)
+	 << " " << as_words(table[word]) << endl;
+    }
   }
 }
 
 void chain_class::output( const string& out_file ){
   ofstream os( out_file );
   multimap<size_t, string,std::greater<size_t>> out_map;
-  for ( const auto& [word,word_set] : table ){
-    for ( const auto& s : word_set ){
+  for ( const auto w_id : words.sorted() ){
+    if ( table[w_id].empty() ){
+      continue;
+    }
+    const UnicodeString word = words.word( w_id );
+    const size_t word_freq = var_freq[w_id];
+    vector<uint32_t> vars( table[w_id].begin(), table[w_id].end() );
+    sort( vars.begin(), vars.end(),
+	  [this]( uint32_t a, uint32_t b ){
+	    return words.word( a ) < words.word( b );
+	  } );
+    for ( const auto s_id : vars ){
+      const UnicodeString s = words.word( s_id );
       stringstream oss;
-      oss << s << "#" << var_freq[s] << "#" << word
-	  << "#" << var_freq[word];
+      oss << s << "#" << var_freq[s_id] << "#" << word
+	  << "#" << word_freq;
       if ( cc_vals_present ){
 	UnicodeString val = w_cc_conf[s+word];
 	if ( val.isEmpty() ){
 	  //	  cerr << "GEEN waarde voor " << s+word << endl;
-	  bitType h1 = ticcl::hash(s, alphabet );
-	  bitType h2 = ticcl::hash(word, alphabet );
+	  bitType h1 = ticcl::hash(s, alpha_table );
+	  bitType h2 = ticcl::hash(word, alpha_table );
 	  bitType h_val;
 	  if ( h1 > h2 ){
 	    h_val = h1 - h2;
@@ -288,7 +338,7 @@ void chain_class::output( const string& out_file ){
 	oss << "#" + w_cc_conf[s+word];
       }
       oss << "#" << ld( word, s, caseless ) << "#C";
-      out_map.insert( make_pair( var_freq[word], oss.str() ) );
+      out_map.insert( make_pair( word_freq, oss.str() ) );
     }
   }
   for ( const auto& t_it : out_map ){
@@ -349,6 +399,7 @@ int main( int argc, char **argv ){
     ifstream is( alphabet_name );
     cout << "start reading alphabet: " << alphabet_name << endl;
     ticcl::fillAlphabet( is, alphabet, 0 );
+    alpha_table.assign( alphabet );
     cout << "finished reading alphabet. (" << alphabet.size() << " characters)"
 	 << endl;
   }
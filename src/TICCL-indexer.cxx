@@ -38,6 +38,7 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <cstdio>
 #include "ticcutils/StringOps.h"
 #include "ticcutils/CommandLine.h"
 #include "ticcutils/Unicode.h"
@@ -55,23 +56,35 @@ using namespace icu;
 using ticcl::bitType;
 
 set<bitType> follow_nums;
+ticcl::join_mode join = ticcl::SIMD_JOIN;
+bool binary = false;
 
 void usage( const string& name ){
   cerr << name << endl;
   cerr << "options: " << endl;
   cerr << "\t--hash=<anahash>\tname of the anagram hashfile. (produced by TICCL-anahash)" << endl;
+  cerr << "\t\t\ttext or binary (TICCL-anahash --bin) format." << endl;
   cerr << "\t--charconf=<charconf>\tname of the character confusion file. (produced by TICCL-lexstat)" << endl;
   cerr << "\t--foci=<focifile>\tname of the file produced by the --artifrq parameter of TICCL-anahash." << endl;
   cerr << "\t\t\t This file is used to limit the searchspace" << endl;
   cerr << "\t-o <outputfile>\t\tname for the outputfile. " << endl;
   cerr << "\t--confstats=<statsfile>\tcreate a list of confusion statistics"
        << endl;
+  cerr << "\t--bin\t\t write the index in the compact binary format." << endl;
+  cerr << "\t\t\t (TICCL-LDcalc reads both formats)" << endl;
   cerr << "\t--low=<low>\t skip entries from the anagram file shorter than "
        << endl;
   cerr << "\t\t\t'low' characters. (default = 5)" << endl;
   cerr << "\t--high=<high>\t skip entries from the anagram file longer than "
        << endl;
   cerr << "\t\t\t'high' characters. (default=35)" << endl;
+  cerr << "\t--join=<mode>\t how to search the anagram values for a confusion."
+       << endl;
+  cerr << "\t\t\t 'simd' (default) compares blocks of values using AVX2 or"
+       << endl;
+  cerr << "\t\t\t AVX-512 when the CPU supports it." << endl;
+  cerr << "\t\t\t 'gallop' skips over ranges that cannot match." << endl;
+  cerr << "\t\t\t 'linear' walks all values one by one." << endl;
   cerr << "\t-t <threads> or --threads <threads>\n\t\t\t Number of threads to run on." << endl;
   cerr << "\t\t\t If 'threads' has the value \"max\", the number of threads is set to a" << endl;
   cerr << "\t\t\t reasonable value. ($OMP_NUM_TREADS - 2)" << endl;
@@ -81,89 +94,147 @@ void usage( const string& name ){
 }
 
 struct experiment {
-  set<bitType>::const_iterator start;
-  set<bitType>::const_iterator finish;
+  // a range of positions in the confusion set
+  size_t start;
+  size_t finish;
 };
 
 
+class out_buffer {
+  // collects the output lines of one experiment, without any locking.
+  // When the buffer grows too large, it is spilled to a temporary file.
+  // copy_to() writes it all out and releases the memory
+public:
+  out_buffer(): n_entries(0), spill(0) {};
+  ~out_buffer(){
+    if ( spill ){
+      fclose( spill );
+    }
+  };
+  out_buffer( const out_buffer& ) = delete;
+  out_buffer& operator=( const out_buffer& ) = delete;
+  void add( const string& line ){
+    buf += line;
+    buf += '\n';
+    ++n_entries;
+    if ( buf.size() > max_buf ){
+      flush();
+    }
+  };
+  void add_entry( const string& bytes ){
+    // an encoded binary index entry
+    buf += bytes;
+    ++n_entries;
+    if ( buf.size() > max_buf ){
+      flush();
+    }
+  };
+  size_t entries() const { return n_entries; };
+  void copy_to( ostream& os ){
+    if ( spill ){
+      flush();
+      rewind( spill );
+      char block[65536];
+      size_t len;
+      while ( (len = fread( block, 1, sizeof(block), spill )) > 0 ){
+	os.write( block, len );
+      }
+    }
+    else {
+      os << buf;
+    }
+    release();
+  };
+private:
+  void release(){
+    string().swap( buf );
+    if ( spill ){
+      fclose( spill );
+      spill = 0;
+    }
+  };
+  void flush(){
+    if ( !spill ){
+      spill = tmpfile();
+      if ( !spill ){
+	throw runtime_error( "unable to create a temporary spill file" );
+      }
+    }
+    if ( fwrite( buf.data(), 1, buf.size(), spill ) != buf.size() ){
+      throw runtime_error( "writing to a temporary spill file failed" );
+    }
+    buf.clear();
+  };
+  static const size_t max_buf = 64*1024*1024;
+  string buf;
+  size_t n_entries;
+  FILE *spill;
+};
+
 void handle_confs( const experiment& exp,
 		   size_t& count,
-		   const set<bitType>& anaSet,
-		   const set<bitType>& focSet,
-		   ostream &of,
-		   ostream *csf ){
-  bitType vorige = 0;
-  bitType totalShift = 0;
-  auto sit = exp.start;
-  while ( sit != exp.finish ){
-    set<bitType> result;
-#pragma omp critical(count)
-    {
-      if ( ++count % 100 == 0 ){
-	cout << ".";
-	cout.flush();
-	if ( count % 5000 == 0 ){
-	  cout << endl << count << endl;
-	}
+		   const ticcl::flat_set& confSet,
+		   const ticcl::flat_set& anaSet,
+		   const ticcl::flat_set& focSet,
+		   out_buffer& of,
+		   out_buffer *csf ){
+  vector<bitType> matches;
+  vector<bitType> result;
+  for ( size_t pos = exp.start; pos < exp.finish; ++pos ){
+    size_t done;
+#pragma omp atomic capture
+    done = ++count;
+    if ( done % 100 == 0 ){
+      cout << ".";
+      cout.flush();
+      if ( done % 5000 == 0 ){
+	cout << endl << done << endl;
       }
     }
-    bitType confusie = *sit;
+    bitType confusie = confSet[pos];
     if ( follow_nums.find(confusie) != follow_nums.end() ){
       cerr << "found confusion value: " << confusie << endl;
     }
-    bitType diff = confusie - vorige;
-    if ( follow_nums.find(diff) != follow_nums.end() ){
-      cerr << "found a difference value: " << diff << endl;
-    }
-    totalShift += diff;
-    auto it1 = anaSet.begin();
-    auto it2 = it1;
-    while ( it1 != anaSet.end() && it2 != anaSet.end() ){
-      bitType v1 = *it1;
-      bitType v2 = *it2;
-      bitType v2_save = v2;
-      if ( v2 >= totalShift ) {
-	v2 -= totalShift;
-      }
-      else {
-	v2 = 0;
+    ticcl::shifted_join( anaSet, confusie, matches, join );
+    result.clear();
+    for ( const auto& v1 : matches ){
+      // if ( follow_nums.find(v1) != follow_nums.end() ){
+      //   cerr << "found a possible focus value: " << v1 << endl;
+      // }
+      bool foc = true;
+      if ( !focSet.empty() ){
+	// do we have to focus?
+	foc = ( focSet.contains( v1 )
+		|| focSet.contains( v1 + confusie ) );
+	// not if both values out of focus
       }
-      if ( v1 == v2 ){
-	// if ( follow_nums.find(v1) != follow_nums.end() ){
-	//   cerr << "found a possible focus value: " << v1 << endl;
-	// }
-	bool foc = true;
-	if ( !focSet.empty() ){
-	  // do we have to focus?
-	  foc = !( focSet.find( v1 ) == focSet.end()
-		   && focSet.find( v2_save ) == focSet.end() );
-	  // not if both values out of focus
+      if ( foc ){
+	result.push_back( v1 );
+	if ( follow_nums.find(v1) != follow_nums.end() ){
+	  cerr << "stored a focus value: " << v1 << endl;
 	}
-	if ( foc ){
-	  auto emp = result.emplace(v1);
-	  if ( emp.second
-	       && follow_nums.find(v1) != follow_nums.end() ){
-	    cerr << "stored a focus value: " << v1 << endl;
-	  }
-	}
-	++it1;
-	++it2;
       }
-      else if ( v1 < v2 ){
-	++it1;
+    }
+    if ( !result.empty() && binary ){
+      string entry;
+      ticcl::index_writer::encode( entry, confusie, result );
+      of.add_entry( entry );
+      for ( const auto& it : result ){
+	if ( follow_nums.find(it) != follow_nums.end() ){
+	  cerr << "Store " << it << " for confusion: " << confusie
+	       << endl;
+	}
       }
-      else {
-	++it2;
+      if ( csf ){
+	csf->add( to_string( confusie ) + "#" + to_string( result.size() ) );
       }
     }
-    vorige = confusie;
-    ++sit;
-    if ( !result.empty() ){
+    else if ( !result.empty() ){
       stringstream ss;
       ss << confusie << "#";
       bool hit = false;
       for ( const auto& it : result ){
-	if ( it != *result.begin() ){
+	if ( it != result.front() ){
 	  ss << ",";
 	}
 	if ( follow_nums.find(it) != follow_nums.end() ){
@@ -177,43 +248,37 @@ void handle_confs( const experiment& exp,
 	   || follow_nums.find(confusie) != follow_nums.end()){
 	cerr << "Stored followed value(s) in: " << ss.str() << endl;
       }
-#pragma omp critical(update)
-      {
-	of << ss.str() << endl;
-	if ( csf ){
-	  *csf << confusie << "#" << result.size() << endl;
-	}
+      of.add( ss.str() );
+      if ( csf ){
+	csf->add( to_string( confusie ) + "#" + to_string( result.size() ) );
       }
     }
   }
 }
 
 size_t init( vector<experiment>& exps,
-	     const set<bitType>& hashes,
+	     size_t size,
 	     size_t threads ){
+  // split the work in a lot of small experiments, much more than threads.
+  // The cost per confusion value varies wildly, so the threads pick the
+  // next experiment dynamically
   exps.clear();
-  size_t partsize = hashes.size() / threads;
-  if ( partsize < 1 ){
-    experiment e;
-    e.start = hashes.begin();
-    e.finish = hashes.end();
-    exps.push_back( e );
-    return 1;
-  }
-  auto hash_it = hashes.begin();
-  for ( size_t i=0; i < threads; ++i ){
+  size_t partsize = max( size / (threads*100), size_t(1) );
+  for ( size_t start=0; start < size; start += partsize ){
     experiment e;
-    e.start = hash_it;
-    for ( size_t j=0; j < partsize && hash_it != hashes.end(); ++j ){
-      ++hash_it;
-    }
-    e.finish = hash_it;
+    e.start = start;
+    e.finish = min( start + partsize, size );
     exps.push_back( e );
   }
-  if ( hash_it != hashes.end() ){
-    exps[exps.size()-1].finish = hashes.end();
+  return exps.size();
+}
+
+void report_busy( const vector<double>& busy,
+		  const vector<size_t>& done ){
+  for ( size_t i=0; i < busy.size(); ++i ){
+    cout << "thread " << i << " was busy for " << busy[i]
+	 << " seconds, on " << done[i] << " experiments" << endl;
   }
-  return threads;
 }
 
 int main( int argc, char **argv ){
@@ -221,7 +286,7 @@ int main( int argc, char **argv ){
   try {
     opts.add_short_options( "vVho:t:" );
     opts.add_long_options( "charconf:,hash:,low:,high:,help,version,"
-			   "foci:,threads:,confstats:,follow:" );
+			   "foci:,threads:,confstats:,follow:,join:,bin" );
     opts.init( argc, argv );
   }
   catch( TiCC::OptionError& e ){
@@ -255,6 +320,7 @@ int main( int argc, char **argv ){
   opts.extract( "confstats", confstats_file );
   opts.extract( "foci", fociFile );
   opts.extract( 'o', outFile );
+  binary = opts.extract( "bin" );
   string value;
   while ( opts.extract( "follow", value ) ){
     bitType follow_num;
@@ -276,6 +342,21 @@ int main( int argc, char **argv ){
       exit( EXIT_FAILURE );
     }
   }
+  if ( opts.extract("join", value ) ){
+    if ( value == "linear" ){
+      join = ticcl::LINEAR_JOIN;
+    }
+    else if ( value == "gallop" ){
+      join = ticcl::GALLOP_JOIN;
+    }
+    else if ( value == "simd" ){
+      join = ticcl::SIMD_JOIN;
+    }
+    else {
+      cerr << "illegal value for --join (" << value << ")" << endl;
+      exit( EXIT_FAILURE );
+    }
+  }
   int numThreads=1;
   value = "1";
   if ( !opts.extract( 't', value ) ){
@@ -312,7 +393,7 @@ int main( int argc, char **argv ){
     exit(1);
   }
 
-  set<bitType> focSet;
+  ticcl::flat_set focSet;
   if ( !fociFile.empty() ){
     ifstream foc( fociFile );
     if ( !foc ){
@@ -335,11 +416,15 @@ int main( int argc, char **argv ){
     outFile += ".index";
   }
 
-  ofstream of( outFile );
+  ofstream of( outFile, binary ? ios::out|ios::binary : ios::out );
   if ( !of ){
     cerr << "problem opening outputfile: " << outFile << endl;
     exit(1);
   }
+  ticcl::index_writer *iw = 0;
+  if ( binary ){
+    iw = new ticcl::index_writer( of );
+  }
   ofstream *csf = 0;
   if ( !confstats_file.empty() ){
     csf = new ofstream( confstats_file );
@@ -349,35 +434,77 @@ int main( int argc, char **argv ){
     }
   }
   cout << "reading corpus word anagram hash values" << endl;
-  ifstream ana( anahashFile );
   size_t skipped = 0;
-  set<bitType> anaSet = ticcl::read_anahash( ana,
-					     lowValue,
-					     highValue,
-					     skipped,
-					     verbose );
+  ticcl::flat_set anaSet = ticcl::read_anahash( anahashFile,
+						 lowValue,
+						 highValue,
+						 skipped,
+						 verbose );
   cout << "read " << anaSet.size() << " corpus anagram values" << endl;
   cout << "skipped " << skipped << " out-of-band corpus anagram values" << endl;
 
   cout << "reading character confusion anagram values" << endl;
   ifstream conf( confFile );
-  set<bitType> confSet = ticcl::read_confusions( conf );
+  ticcl::flat_set confSet = ticcl::read_confusions( conf );
   cout << endl << "read " << confSet.size()
        << " character confusion anagram values" << endl;
 
+  if ( join == ticcl::SIMD_JOIN ){
+    cout << "using SIMD support: " << ticcl::simd_support() << endl;
+  }
+  if ( numThreads < 1 ){
+    numThreads = 1;
+  }
   vector<experiment> experiments;
-  size_t expsize = init( experiments, confSet, numThreads );
+  size_t expsize = init( experiments, confSet.size(), numThreads );
 #ifdef HAVE_OPENMP
-  omp_set_num_threads( expsize );
-  cout << "running on " << expsize << " threads." << endl;
+  omp_set_num_threads( numThreads );
+  cout << "running on " << numThreads << " threads." << endl;
 #endif
 
-
   cout << "processing all character confusion values" << endl;
   size_t count = 0;
-#pragma omp parallel for shared( experiments, of, csf )
+  vector<out_buffer> outputs( expsize );
+  vector<out_buffer> stats( csf ? expsize : 0 );
+  vector<bool> ready( expsize, false );
+  size_t next_out = 0;
+  vector<double> busy( numThreads, 0.0 );
+  vector<size_t> done( numThreads, 0 );
+#pragma omp parallel for schedule(dynamic,1) shared( experiments, outputs, stats, ready, next_out, busy, done )
   for ( size_t i=0; i < expsize; ++i ){
-    handle_confs( experiments[i], count, anaSet, focSet, of, csf );
+#ifdef HAVE_OPENMP
+    double start = omp_get_wtime();
+#endif
+    handle_confs( experiments[i], count, confSet, anaSet, focSet,
+		  outputs[i], csf ? &stats[i] : 0 );
+#ifdef HAVE_OPENMP
+    busy[omp_get_thread_num()] += omp_get_wtime() - start;
+    ++done[omp_get_thread_num()];
+#endif
+    // the experiments are consecutive ranges of the sorted confusions
+    // so, writing them in order keeps the output sorted on confusion value
+#pragma omp critical(output)
+    {
+      ready[i] = true;
+      while ( next_out < expsize && ready[next_out] ){
+	if ( iw ){
+	  iw->added( outputs[next_out].entries() );
+	}
+	outputs[next_out].copy_to( of );
+	if ( csf ){
+	  stats[next_out].copy_to( *csf );
+	}
+	++next_out;
+      }
+    }
+  }
+#ifdef HAVE_OPENMP
+  cout << endl;
+  report_busy( busy, done );
+#endif
+  if ( iw ){
+    iw->finish();
+    delete iw;
   }
   cout << "\nwrote indexes into: " << outFile << endl;
   if ( csf ){
@@ -58,12 +58,15 @@ void usage( const string& name ){
   cerr << name << endl;
   cerr << "options: " << endl;
   cerr << "\t--hash=<anahash>\tname of the anagram hashfile. (produced by TICCL-anahash)" << endl;
+  cerr << "\t\t\ttext or binary (TICCL-anahash --bin) format." << endl;
   cerr << "\t--charconf=<charconf>\tname of the character confusion file. (produced by TICCL-lexstat)" << endl;
   cerr << "\t--foci=<focifile>\tname of the file produced by the --artifrq parameter of TICCL-anahash" << endl;
   cerr << "\t\t\t This file is used to limit the searchspace" << endl;
   cerr << "\t-o <outputfile>\t\tname for the outputfile. " << endl;
   cerr << "\t--confstats=<statsfile>\tcreate a list of confusion statistics"
        << endl;
+  cerr << "\t--bin\t\t write the index in the compact binary format." << endl;
+  cerr << "\t\t\t (TICCL-LDcalc reads both formats)" << endl;
   cerr << "\t--low=<low>\t skip entries from the anagram file shorter than "
        << endl;
   cerr << "\t\t\t'low' characters. (default = 5)" << endl;
@@ -79,132 +82,181 @@ void usage( const string& name ){
 }
 
 struct experiment {
-  set<bitType>::const_iterator start;
-  set<bitType>::const_iterator finish;
+  // a range of positions in the foci set
+  size_t start;
+  size_t finish;
 };
 
 size_t init( vector<experiment>& exps,
-	     const set<bitType>& hashes,
+	     size_t size,
 	     size_t threads ){
+  // split the work in a lot of small experiments, much more than threads.
+  // The cost per focus value varies wildly, so the threads pick the
+  // next experiment dynamically
   exps.clear();
-  size_t partsize = hashes.size() / threads;
-  if ( partsize < 1 ){
+  size_t partsize = max( size / (threads*100), size_t(1) );
+  for ( size_t start=0; start < size; start += partsize ){
     experiment e;
-    e.start = hashes.begin();
-    e.finish = hashes.end();
+    e.start = start;
+    e.finish = min( start + partsize, size );
     exps.push_back( e );
-    return 1;
   }
-  auto s = hashes.begin();
-  for ( size_t i=0; i < threads; ++i ){
-    experiment e;
-    e.start = s;
-    for ( size_t j=0; j < partsize; ++j ){
-      ++s;
-    }
-    e.finish = s;
-    exps.push_back( e );
-  }
-  if ( s != hashes.end() ){
-    exps[exps.size()-1].finish = hashes.end();
+  return exps.size();
+}
+
+void report_busy( const vector<double>& busy,
+		  const vector<size_t>& done ){
+  for ( size_t i=0; i < busy.size(); ++i ){
+    cout << "thread " << i << " was busy for " << busy[i]
+	 << " seconds, on " << done[i] << " experiments" << endl;
   }
-  return threads;
 }
 
+// a hit is a (confusion value, lower anagram value) pair
+typedef pair<bitType,bitType> hit;
+
+template <bool follow>
 void handle_exp( const experiment& exp,
 		 size_t& count,
-		 const set<bitType>& hashSet,
-		 const set<bitType>& confSet,
-		 map<bitType,set<bitType>>& result ){
-  bitType max = *confSet.rbegin();
-  auto it1 = exp.start;
-  while ( it1 != exp.finish ){
-#pragma omp critical
-    {
-      if ( ++count % 100 == 0 ){
-	cout << ".";
-	cout.flush();
-	if ( count % 5000 == 0 ){
-	  cout << endl << count << endl;;
-	}
+		 const ticcl::flat_set& focSet,
+		 const ticcl::flat_set& hashSet,
+		 const ticcl::flat_set& confSet,
+		 const ticcl::flat_hash_set& confHash,
+		 vector<hit>& result ){
+  // result is private to the calling thread, so no locking is needed.
+  // the --follow diagnostics are only compiled in when follow is true
+  bitType max = confSet.back();
+  const bitType *hashes = hashSet.data();
+  const size_t len = hashSet.size();
+  for ( size_t f_pos = exp.start; f_pos < exp.finish; ++f_pos ){
+    size_t done;
+#pragma omp atomic capture
+    done = ++count;
+    if ( done % 100 == 0 ){
+      cout << ".";
+      cout.flush();
+      if ( done % 5000 == 0 ){
+	cout << endl << done << endl;
       }
     }
-    auto it3 = hashSet.find( *it1 );
+    auto it3 = hashSet.find( focSet[f_pos] );
     if ( it3 != hashSet.end() ){
-      set<bitType>::const_reverse_iterator it2( it3 );
-      while ( it2 != hashSet.rend() ){
-#pragma omp critical
-	{
-	  if ( follow_nums.find(*it2) != follow_nums.end() ){
-	    cerr << "following: " << *it2 << endl;
+      const size_t pos = it3 - hashSet.begin();
+      const bitType val = hashes[pos];
+      // walk down from val
+      for ( size_t i = pos; i-- > 0; ){
+	const bitType lower = hashes[i];
+	if constexpr ( follow ){
+	  if ( follow_nums.find(lower) != follow_nums.end() ){
+#pragma omp critical (follow)
+	    cerr << "following: " << lower << endl;
 	  }
 	}
-	bitType diff = *it1 - *it2;
+	bitType diff = val - lower;
 	if ( diff > max ){
 	  break;
 	}
-	if ( confSet.find( diff ) != confSet.end() ){
-#pragma omp critical
-	  {
-	    result[diff].insert(*it2);
+	if ( confHash.contains( diff ) ){
+	  result.emplace_back( diff, lower );
+	  if constexpr ( follow ){
 	    if ( follow_nums.find(diff) != follow_nums.end()
-		 || follow_nums.find(*it2) != follow_nums.end() ){
-	      cerr << "stored :" << diff << ":" << *it2 << endl;
+		 || follow_nums.find(lower) != follow_nums.end() ){
+#pragma omp critical (follow)
+	      cerr << "stored :" << diff << ":" << lower << endl;
 	    }
 	  }
 	}
-	++it2;
       }
-      // it3 is already set at hashSet.find( *it1 );
-      ++it3;
-      while ( it3 != hashSet.end() ){
-#pragma omp critical
-	{
-	  if ( follow_nums.find(*it1) != follow_nums.end() ){
-	    cerr << "following: " << *it1 << endl;
+      // and walk up from val
+      for ( size_t i = pos+1; i < len; ++i ){
+	const bitType higher = hashes[i];
+	if constexpr ( follow ){
+	  if ( follow_nums.find(val) != follow_nums.end() ){
+#pragma omp critical (follow)
+	    cerr << "following: " << val << endl;
 	  }
 	}
-	bitType diff = *it3 - *it1;
+	bitType diff = higher - val;
 	if ( diff > max ){
 	  break;
 	}
-	if ( confSet.find( diff ) != confSet.end() ){
-#pragma omp critical
-	  {
-	    result[diff].insert(*it1);
+	if ( confHash.contains( diff ) ){
+	  result.emplace_back( diff, val );
+	  if constexpr ( follow ){
 	    if ( follow_nums.find(diff) != follow_nums.end()
-		 || follow_nums.find(*it1) != follow_nums.end() ){
-	      cerr << "stored :" << diff << ":" << *it1 << endl;
+		 || follow_nums.find(val) != follow_nums.end() ){
+#pragma omp critical (follow)
+	      cerr << "stored :" << diff << ":" << val << endl;
 	    }
 	  }
 	}
-	++it3;
       }
     }
-    ++it1;
   }
 }
 
-void output_result( ostream& os,
-		    const map<bitType,set<bitType>>& result ){
-  for ( auto const& [bt,bt_set] : result ){
-    os << bt << "#";
-    for ( const auto& it: bt_set ){
-      os << it;
-      if ( it != *bt_set.rbegin() ){
+void write_entry( ostream& os,
+		  ostream *csf,
+		  ticcl::index_writer *iw,
+		  bitType conf,
+		  const vector<bitType>& lows ){
+  if ( iw ){
+    iw->add( conf, lows );
+  }
+  else {
+    os << conf << "#";
+    for ( size_t i=0; i < lows.size(); ++i ){
+      if ( i > 0 ){
 	os << ",";
       }
+      os << lows[i];
     }
     os << endl;
-    os.flush();
+  }
+  if ( csf ){
+    *csf << conf << "#" << lows.size() << endl;
   }
 }
 
-void output_confusions( ostream& csf,
-			const map<bitType,set<bitType>>& result ){
-  for ( auto const& [bt,bt_set] : result ){
-    csf << bt << "#" << bt_set.size() << endl;
-    csf.flush();
+void output_result( ostream& os,
+		    ostream *csf,
+		    ticcl::index_writer *iw,
+		    const vector<vector<hit>>& results ){
+  // every vector in results is sorted. A k-way merge over them yields all
+  // hits in (confusion, low) order. Hits found by more than one thread
+  // are written only once
+  vector<size_t> cur( results.size(), 0 );
+  bitType current = 0;
+  vector<bitType> lows;
+  while ( true ){
+    int best = -1;
+    for ( size_t k=0; k < results.size(); ++k ){
+      if ( cur[k] < results[k].size()
+	   && ( best < 0
+		|| results[k][cur[k]] < results[best][cur[best]] ) ){
+	best = k;
+      }
+    }
+    if ( best < 0 ){
+      break;
+    }
+    const hit& h = results[best][cur[best]++];
+    if ( !lows.empty() && h.first == current ){
+      if ( h.second != lows.back() ){
+	lows.push_back( h.second );
+      }
+    }
+    else {
+      if ( !lows.empty() ){
+	write_entry( os, csf, iw, current, lows );
+      }
+      current = h.first;
+      lows.clear();
+      lows.push_back( h.second );
+    }
+  }
+  if ( !lows.empty() ){
+    write_entry( os, csf, iw, current, lows );
   }
 }
 
@@ -213,7 +265,7 @@ int main( int argc, char **argv ){
   try {
     opts.add_short_options( "vVho:t:" );
     opts.add_long_options( "charconf:,hash:,low:,high:,foci:,help,"
-			   "version,threads:,confstats:,follow:" );
+			   "version,threads:,confstats:,follow:,bin" );
     opts.init( argc, argv );
   }
   catch( TiCC::OptionError& e ){
@@ -256,6 +308,7 @@ int main( int argc, char **argv ){
   }
   opts.extract( "confstats", confstats_file );
   opts.extract( 'o', outFile );
+  bool binary = opts.extract( "bin" );
   int num_threads = 1;
   string value = "1";
   if ( !opts.extract( 't', value ) ){
@@ -311,6 +364,9 @@ int main( int argc, char **argv ){
   }
   if ( outFile.empty() ){
     outFile = anahashFile;
+    if ( TiCC::match_back( outFile, ".bin" ) ){
+      outFile.resize( outFile.size() - 4 );
+    }
     string::size_type pos = outFile.rfind(".");
     if ( pos != string::npos ){
       outFile.resize(pos);
@@ -329,7 +385,7 @@ int main( int argc, char **argv ){
       exit(1);
     }
   }
-  ofstream of( outFile );
+  ofstream of( outFile, binary ? ios::out|ios::binary : ios::out );
   if ( !of ){
     cerr << "problem opening output file: " << outFile << endl;
     exit(1);
@@ -347,47 +403,87 @@ int main( int argc, char **argv ){
   }
 
   cout << "reading corpus word anagram hash values" << endl;
-  ifstream cwav( anahashFile );
   size_t skipped = 0;
-  set<bitType> hashSet = ticcl::read_anahash( cwav,
-					      lowValue,
-					      highValue,
-					      skipped,
-					      verbose );
+  ticcl::flat_set hashSet = ticcl::read_anahash( anahashFile,
+						  lowValue,
+						  highValue,
+						  skipped,
+						  verbose );
   cout << "read " << hashSet.size() << " corpus word anagram values" << endl;
   cout << "skipped " << skipped << " out-of-band corpus word values" << endl;
 
   ifstream foc( fociFile );
-  set<bitType> focSet = ticcl::read_bit_set( foc );
+  ticcl::flat_set focSet = ticcl::read_bit_set( foc );
   cout << "read " << focSet.size() << " foci values" << endl;
 
   ifstream conf( confFile );
-  set<bitType> confSet = ticcl::read_confusions( conf );
+  ticcl::flat_set confSet = ticcl::read_confusions( conf );
   cout << "read " << confSet.size()
        << " character confusion anagram values" << endl;
+  const ticcl::flat_hash_set confHash( confSet );
 
+  if ( num_threads < 1 ){
+    num_threads = 1;
+  }
   vector<experiment> experiments;
-  size_t expsize = init( experiments, focSet, num_threads );
+  size_t expsize = init( experiments, focSet.size(), num_threads );
 
   cout << "created " << expsize << " separate experiments" << endl;
 
 #ifdef HAVE_OPENMP
-  omp_set_num_threads( expsize );
-  cout << "running on " << expsize << " threads." << endl;
+  omp_set_num_threads( num_threads );
+  cout << "running on " << num_threads << " threads." << endl;
 #endif
 
   size_t count = 0;
-  map<bitType,set<bitType> > result;
-#pragma omp parallel for shared( experiments, count, result )
+  vector<vector<hit>> results( num_threads );
+  vector<double> busy( num_threads, 0.0 );
+  vector<size_t> done( num_threads, 0 );
+  const bool following = !follow_nums.empty();
+#pragma omp parallel for schedule(dynamic,1) shared( experiments, count, results, busy, done )
   for ( size_t i=0; i < expsize; ++i ){
-    handle_exp( experiments[i], count, hashSet, confSet, result );
+    int thread = 0;
+#ifdef HAVE_OPENMP
+    thread = omp_get_thread_num();
+    double start = omp_get_wtime();
+#endif
+    if ( following ){
+      handle_exp<true>( experiments[i], count, focSet, hashSet, confSet,
+			confHash, results[thread] );
+    }
+    else {
+      handle_exp<false>( experiments[i], count, focSet, hashSet, confSet,
+			 confHash, results[thread] );
+    }
+#ifdef HAVE_OPENMP
+    busy[thread] += omp_get_wtime() - start;
+    ++done[thread];
+#endif
   }
+#ifdef HAVE_OPENMP
+  cout << endl;
+  report_busy( busy, done );
+#endif
 
-  output_result( of, result );
+#pragma omp parallel for schedule(dynamic,1) shared( results )
+  for ( size_t k=0; k < results.size(); ++k ){
+    sort( results[k].begin(), results[k].end() );
+    results[k].erase( unique( results[k].begin(), results[k].end() ),
+		      results[k].end() );
+  }
+
+  ticcl::index_writer *iw = 0;
+  if ( binary ){
+    iw = new ticcl::index_writer( of );
+  }
+  output_result( of, csf, iw, results );
+  if ( iw ){
+    iw->finish();
+    delete iw;
+  }
 
   cout << "\nwrote indexes into: " << outFile << endl;
   if ( csf ){
-    output_confusions( *csf, result );
     cout << "wrote confusion statistics into: " << confstats_file << endl;
     csf->close();
     delete csf;
@@ -31,6 +31,8 @@
 #include <map>
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <algorithm>
 
 #include "ticcutils/StringOps.h"
 #include "ticcutils/CommandLine.h"
@@ -39,6 +41,9 @@
 #include "ticcl/ticcl_common.h"
 
 #include "config.h"
+#ifdef HAVE_OPENMP
+#include "omp.h"
+#endif
 
 bool verbose = false;
 
@@ -146,11 +151,11 @@ void create_dia_file( const string& filename,
   cout << "created a diacritic confusion file: " << filename << endl;
 }
 
-void meld_botsing( const multimap<bitType,UnicodeString>& mm, bitType h ){
+void meld_botsing( const vector<UnicodeString>& labels, bitType h ){
+  // labels holds all labels for h, in the order of generation
   map<set<UChar>,UnicodeString > ref;
-  for ( auto it = mm.lower_bound(h); it != mm.upper_bound(h); ++it ){
+  for ( const auto& s : labels ){
     set<UChar> st;
-    UnicodeString s = it->second;
     for( int i=0; i < s.length(); ++i ){
       st.insert( s[i] );
     }
@@ -163,15 +168,235 @@ void meld_botsing( const multimap<bitType,UnicodeString>& mm, bitType h ){
   cerr << endl;
 }
 
-void conditionally_insert( multimap<bitType,UnicodeString>& confusions,
-			   bitType key,
-			   const UnicodeString& value,
-			   bool full ){
-  if ( full ){
-    confusions.insert( make_pair( key, value ) );
+struct confusion {
+  // a character confusion without its label: the alphabet indices of the
+  // characters left of the '~', followed by those on the right.
+  // The label is only built when the confusion is written.
+  bitType key;
+  uint64_t seq;  // the order of generation, for the same chars[0]
+  uint16_t chars[6];
+  uint8_t left;
+  uint8_t size;
+};
+
+bool generated_before( const confusion& c1, const confusion& c2 ){
+  // the order of the old sequential loops
+  if ( c1.key != c2.key ){
+    return c1.key < c2.key;
+  }
+  if ( c1.chars[0] != c2.chars[0] ){
+    return c1.chars[0] < c2.chars[0];
+  }
+  return c1.seq < c2.seq;
+}
+
+UnicodeString label( const confusion& c,
+		     const vector<UnicodeString>& alphabet ){
+  UnicodeString result;
+  for ( uint8_t i=0; i < c.size; ++i ){
+    if ( i == c.left ){
+      result += "~";
+    }
+    result += alphabet[c.chars[i]];
+  }
+  if ( c.left == c.size ){
+    result += "~";
+  }
+  return result;
+}
+
+class first_confusions {
+  // keeps only the first confusion added for every key, in an open
+  // addressing hash table with a load factor below 0.5
+public:
+  first_confusions(): _bits(10), _size(0) {
+    _table.resize( size_t(1) << _bits );
+    _used.resize( _table.size(), 0 );
+  };
+  void insert( const confusion& c ){
+    size_t i = slot( c.key );
+    while ( _used[i] ){
+      if ( _table[i].key == c.key ){
+	return;
+      }
+      i = (i+1) & ( _table.size() - 1 );
+    }
+    _table[i] = c;
+    _used[i] = 1;
+    if ( 2 * ++_size > _table.size() ){
+      grow();
+    }
+  };
+  void collect( vector<confusion>& result ) const {
+    for ( size_t i=0; i < _table.size(); ++i ){
+      if ( _used[i] ){
+	result.push_back( _table[i] );
+      }
+    }
+  };
+private:
+  size_t slot( bitType key ) const {
+    return ( key * 0x9E3779B97F4A7C15ULL ) >> ( 64 - _bits );
+  };
+  void grow(){
+    vector<confusion> old;
+    collect( old );
+    ++_bits;
+    _table.assign( size_t(1) << _bits, confusion() );
+    _used.assign( _table.size(), 0 );
+    _size = 0;
+    for ( const auto& c : old ){
+      insert( c );
+    }
+  };
+  vector<confusion> _table;
+  vector<char> _used;
+  int _bits;
+  size_t _size;
+};
+
+inline bitType diff( bitType d1, bitType d2 ){
+  return ( d1 > d2 ) ? d1 - d2 : d2 - d1;
+}
+
+class confusion_generator {
+  // generates all confusions starting with one character, in the order
+  // of the old nested loops.
+  // Without 'full', only the first confusion per key is kept. Then we
+  // skip every confusion of which the characters on one side are not in
+  // alphabet order: the same characters in order give the same key and
+  // come earlier, so they win anyway.
+public:
+  confusion_generator( const vector<bitType>& vals, int depth, bool full ):
+    _vals( vals ), _depth( depth ), _full( full ), _seq( 0 ) {};
+  void generate( uint16_t );
+  void collect( vector<confusion>& result ) const {
+    if ( _full ){
+      result.insert( result.end(), _all.begin(), _all.end() );
+    }
+    else {
+      _first.collect( result );
+    }
+  };
+private:
+  void add( bitType key, std::initializer_list<uint16_t> chars,
+	    uint8_t left ){
+    confusion c;
+    c.key = key;
+    c.seq = _seq++;
+    c.left = left;
+    c.size = 0;
+    for ( const auto ch : chars ){
+      c.chars[c.size++] = ch;
+    }
+    if ( _full ){
+      _all.push_back( c );
+    }
+    else {
+      _first.insert( c );
+    }
+  };
+  const vector<bitType>& _vals;
+  int _depth;
+  bool _full;
+  uint64_t _seq;
+  first_confusions _first;
+  vector<confusion> _all;
+};
+
+void confusion_generator::generate( uint16_t i1 ){
+  const uint16_t n = _vals.size();
+  const bitType *v = _vals.data();
+  const bool prune = !_full;
+  // a side of a confusion is in order, or we don't care
+  auto in_order = [prune]( uint16_t a, uint16_t b ){
+    return !prune || a <= b;
+  };
+  _seq = 0;
+  // deletions/inserts of 1
+  add( v[i1], {i1}, 1 );
+  for ( uint16_t i2=0; i2 < n; ++i2 ){
+    if ( i2 != i1 ){
+      // 1-1 substitutions
+      add( diff( v[i1], v[i2] ), {i1,i2}, 1 );
+    }
+  }
+  if ( _depth < 2 ){
+    return;
   }
-  else if ( confusions.find( key ) == confusions.end() ){
-    confusions.insert( make_pair( key, value ) );
+  for ( uint16_t i2=0; i2 < n; ++i2 ){
+    const bool left2 = in_order( i1, i2 );
+    if ( left2 ){
+      // 2-0 substitutions
+      add( v[i1] + v[i2], {i1,i2}, 2 );
+    }
+    for ( uint16_t i3=0; i3 < n; ++i3 ){
+      const bool left3 = left2 && in_order( i2, i3 );
+      if ( left2 && i3 != i2 && i3 != i1 ){
+	// 2-1 substitutions
+	add( diff( v[i1] + v[i2], v[i3] ), {i1,i2,i3}, 2 );
+      }
+      if ( in_order( i2, i3 ) && i2 != i1 && i3 != i1 ){
+	// 1-2 substitutions
+	add( diff( v[i1], v[i2] + v[i3] ), {i1,i2,i3}, 1 );
+      }
+      for ( uint16_t i4=0; i4 < n; ++i4 ){
+	const bool i4_free2 = ( i4 != i1 && i4 != i2 );
+	const bool i4_free3 = i4_free2 && i4 != i3;
+	if ( left2 && in_order( i3, i4 )
+	     && i3 != i1 && i3 != i2 && i4_free2 ){
+	  // 2-2 substitutions
+	  add( diff( v[i1] + v[i2], v[i3] + v[i4] ), {i1,i2,i3,i4}, 2 );
+	}
+	if ( _depth < 3 ){
+	  continue;
+	}
+	if ( left3 && i4 == 0 ){
+	  // 3-0 substitutions. The same for every i4, so only the first
+	  add( v[i1] + v[i2] + v[i3], {i1,i2,i3}, 3 );
+	}
+	if ( left3 && i4_free3 ){
+	  // 3-1 substitutions
+	  add( diff( v[i4], v[i3] + v[i2] + v[i1] ), {i1,i2,i3,i4}, 3 );
+	}
+	if ( in_order( i2, i3 ) && in_order( i3, i4 )
+	     && i2 != i1 && i3 != i1 && i4 != i1 ){
+	  // 1-3 substitutions
+	  add( diff( v[i1], v[i2] + v[i3] + v[i4] ), {i1,i2,i3,i4}, 1 );
+	}
+	const bool do_32 = left3 && i4_free3;
+	const bool do_23 = left2 && in_order( i3, i4 )
+	  && i3 != i1 && i3 != i2 && i4_free2;
+	if ( !do_32 && !do_23 ){
+	  // nothing to do for any i5 or i6
+	  continue;
+	}
+	for ( uint16_t i5 = ( prune ? i4 : 0 ); i5 < n; ++i5 ){
+	  const bool i5_free2 = ( i5 != i1 && i5 != i2 );
+	  const bool i5_free3 = i5_free2 && i5 != i3;
+	  if ( do_32 && i5_free3 ){
+	    // 3-2 substitutions
+	    add( diff( v[i5] + v[i4], v[i3] + v[i2] + v[i1] ),
+		 {i1,i2,i3,i4,i5}, 3 );
+	  }
+	  if ( do_23 && i5_free2 ){
+	    // 2-3 substitutions
+	    add( diff( v[i5] + v[i4] + v[i3], v[i2] + v[i1] ),
+		 {i1,i2,i3,i4,i5}, 2 );
+	  }
+	  if ( !do_32 || !i5_free3 ){
+	    continue;
+	  }
+	  for ( uint16_t i6 = ( prune ? i5 : 0 ); i6 < n; ++i6 ){
+	    if ( i6 != i1 && i6 != i2 && i6 != i3 ){
+	      // 3-3 substitutions
+	      add( diff( v[i6] + v[i5] + v[i4], v[i3] + v[i2] + v[i1] ),
+		   {i1,i2,i3,i4,i5,i6}, 3 );
+	    }
+	  }
+	}
+      }
+    }
   }
 }
 
@@ -184,197 +409,48 @@ void generate_confusion( const string& name,
     cerr << "unable to open output file: " << name << endl;
     exit(EXIT_FAILURE);
   }
-  multimap<bitType,UnicodeString> confusions;
+  if ( hashes.size() > UINT16_MAX ){
+    cerr << "alphabet too large: " << hashes.size() << endl;
+    exit(EXIT_FAILURE);
+  }
+  vector<UnicodeString> alphabet;
+  vector<bitType> vals;
+  for ( const auto& [str,val] : hashes ){
+    alphabet.push_back( str );
+    vals.push_back( val );
+  }
   cout << "start : " << hashes.size() << " iterations " << endl;
-  auto it1 = hashes.cbegin();
-  while ( it1 != hashes.cend() ){
-    cout << it1->first << " ";
-    // deletions/inserts of 1
-    UnicodeString s1 = it1->first + "~";
-    conditionally_insert( confusions, it1->second, s1, full );
-    auto it2 = hashes.cbegin();
-    while ( it2 != hashes.cend() ){
-      if ( it2 != it1 ){
-	// 1-1 substitutions
-	bitType div11;
-	if ( it2->second > it1->second ){
-	  div11 = it2->second - it1->second;
-	}
-	else {
-	  div11 = it1->second - it2->second;
-	}
-	UnicodeString s2 = it1->first + "~" + it2->first;
-	conditionally_insert( confusions, div11, s2, full );
+  vector<confusion> confusions;
+#pragma omp parallel
+  {
+    confusion_generator generator( vals, depth, full );
+#pragma omp for schedule(dynamic,1)
+    for ( size_t i1=0; i1 < alphabet.size(); ++i1 ){
+      generator.generate( i1 );
+#pragma omp critical (progress)
+      {
+	cout << alphabet[i1] << " " << flush;
       }
-      ++it2;
     }
-    if ( depth > 1 ){
-      it2 = hashes.begin();
-      while ( it2 != hashes.end() ){
-	// 2-0 substitutions
-	UnicodeString s20 = it1->first + it2->first + "~";
-	bitType div20 = it2->second + it1->second;
-	conditionally_insert( confusions, div20, s20, full );
-	auto it3 = hashes.cbegin();
-	while ( it3 != hashes.cend() ){
-	  if ( it3 != it2 && it3 != it1 ){
-	    // 2-1 substitutions
-	    UnicodeString s = it1->first + it2->first + "~" + it3->first;
-	    bitType div21;
-	    bitType d1 = it1->second + it2->second;
-	    bitType d2 = it3->second;
-	    if ( d1 > d2 ){
-	      div21 = d1 - d2;
-	    }
-	    else {
-	      div21 = d2 - d1;
-	    }
-	    conditionally_insert( confusions, div21, s, full );
-	  }
-	  if ( it2 != it1 && it3 != it1 ){
-	    // 1-2 substitutions
-	    UnicodeString s = it1->first + "~" + it2->first + it3->first;
-	    bitType div12;
-	    bitType d1 = it1->second;
-	    bitType d2 = it2->second + it3->second;
-	    if ( d1 > d2 ){
-	      div12 = d1 - d2;
-	    }
-	    else {
-	      div12 = d2 - d1;
-	    }
-	    conditionally_insert( confusions, div12, s, full );
-	  }
-	  auto it4 = hashes.cbegin();
-	  while ( it4 != hashes.cend() ){
-	    if ( it3 != it1 && it3 != it2 && it4 != it1 && it4 != it2 ){
-	      // 2-2 substitutions
-	      UnicodeString s = it1->first + it2->first + "~"
-		+ it3->first + it4->first;
-	      bitType div22;
-	      bitType d1 = it1->second + it2->second;
-	      bitType d2 = it3->second + it4->second;
-	      if ( d1 > d2 ){
-		div22 = d1 - d2;
-	      }
-	      else {
-		div22 = d2 - d1;
-	      }
-	      conditionally_insert( confusions, div22, s, full );
-	    }
-	    if ( depth > 2 ){
-	      // 3-0 substitutions
-	      UnicodeString s30 = it1->first + it2->first + it3->first + "~";
-	      bitType div30 = it1->second + it2->second + it3->second;
-	      conditionally_insert( confusions, div30, s30, full );
-	      if ( it4 != it1 && it4 != it2 && it4 != it3 ){
-		// 3-1 substitutions
-		UnicodeString s = it1->first + it2->first + it3->first + "~"
-		  + it4->first;
-		bitType div31;
-		bitType d1 = it4->second;
-		bitType d2 = it3->second + it2->second + it1->second;
-		if ( d1 > d2 ){
-		  div31 = d1 - d2;
-		}
-		else {
-		  div31 = d2 - d1;
-		}
-		conditionally_insert( confusions, div31, s, full );
-	      }
-	      if ( it2 != it1 && it3 != it1 && it4 != it1 ){
-		// 1-3 substitutions
-		UnicodeString s = it1->first + "~"
-		  + it2->first + it3->first + it4->first;
-		bitType div13;
-		bitType d1 = it1->second;
-		bitType d2 = it2->second + it3->second + it4->second;
-		if ( d1 > d2 ){
-		  div13 = d1 - d2;
-		}
-		else {
-		  div13 = d2 - d1;
-		}
-		conditionally_insert( confusions, div13, s, full );
-	      }
-	      auto it5 = hashes.cbegin();
-	      while ( it5 != hashes.cend() ){
-		if ( it4 != it1 && it4 != it2 && it4 != it3 &&
-		     it5 != it1 && it5 != it2 && it5 != it3 ){
-		  // 3-2 substitutions
-		  UnicodeString s = it1->first + it2->first + it3->first + "~"
-		    + it4->first + it5->first;
-		  bitType div32;
-		  bitType d1 = it5->second + it4->second;
-		  bitType d2 = it3->second + it2->second + it1->second;
-		  if ( d1 > d2 ){
-		    div32 = d1 - d2;
-		  }
-		  else {
-		    div32 = d2 - d1;
-		  }
-		  conditionally_insert( confusions, div32, s, full );
-		}
-		if ( it3 != it1 && it3 != it2 &&
-		     it4 != it1 && it4 != it2 &&
-		     it5 != it1 && it5 != it2 ){
-		  // 2-3 substitutions
-		  UnicodeString s = it1->first + it2->first + "~" + it3->first
-		    +it4->first + it5->first;
-		  bitType div23;
-		  bitType d1 = it5->second + it4->second + it3->second;
-		  bitType d2 = it2->second + it1->second;
-		  if ( d1 > d2 ){
-		    div23 = d1 - d2;
-		  }
-		  else {
-		    div23 = d2 - d1;
-		  }
-		  conditionally_insert( confusions, div23, s, full );
-		}
-		auto it6 = hashes.cbegin();
-		while ( it6 != hashes.cend() ){
-		  if ( it6 != it1 && it6 != it2 && it6 != it3 &&
-		       it5 != it1 && it5 != it2 && it5 != it3 &&
-		       it4 != it1 && it4 != it2 && it4 != it3 ){
-		    // 3-3 substitutions
-		    UnicodeString s = it1->first + it2->first + it3->first + "~"
-		      +it4->first + it5->first + it6->first;
-		    bitType d1 = it6->second + it5->second + it4->second;
-		    bitType d2 = it3->second + it2->second + it1->second;
-		    bitType div33;
-		    if ( d1 > d2 ){
-		      div33 = d1 - d2;
-		    }
-		    else {
-		      div33 = d2 - d1;
-		    }
-		    conditionally_insert( confusions, div33, s, full );
-		  }
-		  ++it6;
-		}
-		++it5;
-	      }
-	    }
-	    ++it4;
-	  }
-	  ++it3;
-	}
-	++it2;
-      }
+#pragma omp critical (collect)
+    {
+      generator.collect( confusions );
     }
-    ++it1;
   }
-  auto cit = confusions.begin();
+  // the threads handled increasing values of the first character, so
+  // sorting on the order of generation gives the same result as the
+  // sequential loops did
+  sort( confusions.begin(), confusions.end(), generated_before );
   if ( full ){
     bitType start=0;
     set<UnicodeString> unique;
-    while ( cit != confusions.end() ){
-      if ( cit->first != start ){
+    vector<UnicodeString> in_order;
+    for ( const auto& c : confusions ){
+      if ( c.key != start ){
 	// a new KWC starts
 	if ( !unique.empty() ){
 	  if ( unique.size() > 8 ){
-	    meld_botsing( confusions, start );
+	    meld_botsing( in_order, start );
 	  }
 	  os << start;
 	  for ( const auto& un : unique ){
@@ -383,16 +459,24 @@ void generate_confusion( const string& name,
 	  os << endl;
 	  unique.clear();
 	}
-	start = cit->first;
+	in_order.clear();
+	start = c.key;
       }
-      unique.insert( cit->second );
-      ++cit;
+      UnicodeString lab = label( c, alphabet );
+      unique.insert( lab );
+      in_order.push_back( lab );
     }
   }
   else {
-    while ( cit != confusions.end() ){
-      os << cit->first << "#" << cit->second << endl;
-      ++cit;
+    bool first = true;
+    bitType last = 0;
+    for ( const auto& c : confusions ){
+      if ( first || c.key != last ){
+	// only the first of every key
+	os << c.key << "#" << label( c, alphabet ) << endl;
+	last = c.key;
+	first = false;
+      }
     }
   }
   cout << endl << "generated confusion file " << name << endl;
@@ -411,6 +495,9 @@ void usage( const string& name ){
   cerr << "\t--separator=<sep> Add the 'sep' symbol to the alphabet." << endl;
   cerr << "\t--all\tfull output. Show ALL variants in the confusions file." << endl;
   cerr << "\t\tNormally only the first is shown." << endl;
+  cerr << "\t-t <threads> or --threads <threads> Number of threads to run on." << endl;
+  cerr << "\t\t\t If 'threads' has the value \"max\", the number of threads is set to a" << endl;
+  cerr << "\t\t\t reasonable value. (OMP_NUM_THREADS - 2)" << endl;
   cerr << "\t-h or --help\t this message " << endl;
   cerr << "\t-v or --verbose\t give more details during run." << endl;
   cerr << "\t-V or --version\t show version " << endl;
@@ -419,8 +506,8 @@ void usage( const string& name ){
 int main( int argc, const char *argv[] ){
   TiCC::CL_Options opts;
   try {
-    opts.add_short_options( "vVho:" );
-    opts.add_long_options( "LD:,clip:,diac,all,separator:,help,verbose,version" );
+    opts.add_short_options( "vVho:t:" );
+    opts.add_long_options( "LD:,clip:,diac,all,separator:,help,verbose,version,threads:" );
     opts.init( argc, argv );
   }
   catch( TiCC::OptionError& e ){
@@ -470,6 +557,30 @@ int main( int argc, const char *argv[] ){
       exit(EXIT_FAILURE);
     }
   }
+  value = "1";
+  if ( !opts.extract( 't', value ) ){
+    opts.extract( "threads", value );
+  }
+#ifdef HAVE_OPENMP
+  int numThreads = 1;
+  if ( TiCC::lowercase(value) == "max" ){
+    numThreads = max( omp_get_max_threads() - 2, 1 );
+  }
+  else {
+    if ( !TiCC::stringTo(value,numThreads) ) {
+      cerr << "illegal value for -t (" << value << ")" << endl;
+      exit( EXIT_FAILURE );
+    }
+    numThreads = max( numThreads, 1 );
+  }
+  omp_set_num_threads( numThreads );
+#else
+  if ( value != "1" ){
+    cerr << "unable to set number of threads!.\nNo OpenMP support available!"
+	 <<endl;
+    exit(EXIT_FAILURE);
+  }
+#endif
   UnicodeString separator;
   if ( opts.extract( "separator", separator ) ){
     if ( separator.length() != 1 ){
@@ -31,12 +31,20 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <queue>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
 
 #include "ticcutils/CommandLine.h"
 #include "ticcutils/FileUtils.h"
 #include "ticcutils/StringOps.h"
 #include "ticcutils/XMLtools.h"
 #include "ticcutils/Unicode.h"
+#include "ticcl/ticcl_common.h"
 
 #include "config.h"
 #ifdef HAVE_OPENMP
@@ -48,7 +56,7 @@ using namespace	TiCC;
 
 bool verbose = false;
 
-void create_wf_list( const map<UnicodeString, unsigned int>& wc,
+void create_wf_list( const ticcl::word_table& wc,
 		     const string& filename, unsigned int total_in, bool doperc ){
   ofstream os( filename );
   if ( !os ){
@@ -56,8 +64,8 @@ void create_wf_list( const map<UnicodeString, unsigned int>& wc,
     exit(EXIT_FAILURE);
   }
   map<unsigned int, set<UnicodeString> > wf;
-  for( const auto& cit : wc ){
-    wf[cit.second].insert( cit.first );
+  for ( uint32_t id=0; id < wc.size(); ++id ){
+    wf[wc.count( id )].insert( wc.word( id ) );
   }
   unsigned int sum=0;
   unsigned int types=0;
@@ -84,8 +92,8 @@ void create_wf_list( const map<UnicodeString, unsigned int>& wc,
   }
 }
 
-size_t read_words( const string& doc_name,
-		   map<UnicodeString,unsigned int>& wc ){
+template <class Add>
+size_t read_words( const string& doc_name, Add add ){
   size_t word_total = 0;
   ifstream is( doc_name );
   UnicodeString line;
@@ -97,15 +105,342 @@ size_t read_words( const string& doc_name,
     }
     UnicodeString wrd = v[0];
     size_t frq = stringTo<int>(v[1]);
-#pragma omp critical
-    {
-      wc[wrd] += frq;
-    }
+    add( wrd, frq );
     word_total += frq;
   }
   return word_total;
 }
 
+//
+// the external merge. The lexicons are counted until the memory budget is
+// used up, then the counts are written to a temporary 'run' file, sorted
+// on the words. All runs are merged with a heap, summing the frequencies
+// of equal words, into new runs sorted on frequency. Merging those gives
+// the output list. Merges are done at most MAX_FAN_IN runs at a time.
+//
+
+const size_t MAX_FAN_IN = 128;
+
+size_t entry_size( const UnicodeString& word ){
+  // a rough estimate of the memory one entry takes
+  return 2 * word.length() + 48;
+}
+
+vector<string> run_files; // all temporary files, for the cleanup
+
+void remove_runs(){
+  // registered with atexit(), so no runs are left behind, whatever way
+  // we exit. Removing an already merged run is harmless
+  for ( const auto& name : run_files ){
+    remove( name.c_str() );
+  }
+}
+
+string run_name( const string& prefix ){
+  // the pid keeps runs of simultaneous merges into the same place apart
+  string name;
+#pragma omp critical (run_name)
+  {
+    if ( run_files.empty() ){
+      atexit( remove_runs );
+    }
+    name = prefix + ".mergelex." + TiCC::toString( getpid() )
+      + "." + TiCC::toString( run_files.size() ) + ".tmp";
+    run_files.push_back( name );
+  }
+  return name;
+}
+
+class run_reader {
+  // reads back a run file: lines of word<TAB>frequency
+public:
+  explicit run_reader( const string& name ): _is( name ) { next(); };
+  bool good() const { return _good; };
+  const UnicodeString& word() const { return _word; };
+  uint64_t freq() const { return _freq; };
+  void next(){
+    string line;
+    _good = static_cast<bool>( std::getline( _is, line ) );
+    if ( _good ){
+      string::size_type tab = line.find( '\t' );
+      _word = TiCC::UnicodeFromUTF8( line.substr( 0, tab ) );
+      _freq = stoull( line.substr( tab+1 ) );
+    }
+  };
+private:
+  ifstream _is;
+  UnicodeString _word;
+  uint64_t _freq = 0;
+  bool _good = false;
+};
+
+class run_writer {
+public:
+  explicit run_writer( const string& name ): _name( name ), _os( name ) {
+    if ( !_os ){
+      cerr << "unable to create temporary file '" << name << "'" << endl;
+      exit(EXIT_FAILURE);
+    }
+  };
+  const string& name() const { return _name; };
+  void add( const UnicodeString& word, uint64_t freq ){
+    _os << TiCC::UnicodeToUTF8( word ) << "\t" << freq << "\n";
+  };
+private:
+  string _name;
+  ofstream _os;
+};
+
+bool by_word( const run_reader& a, const run_reader& b ){
+  return a.word() < b.word();
+}
+
+bool by_freq( const run_reader& a, const run_reader& b ){
+  // descending frequencies, and the words in order, like create_wf_list()
+  return a.freq() > b.freq()
+    || ( a.freq() == b.freq() && a.word() < b.word() );
+}
+
+template <class Before, class Sink>
+void merge_runs( const vector<string>& names, Before before, Sink sink ){
+  // a k-way merge, removing the runs afterwards
+  vector<unique_ptr<run_reader>> readers;
+  for ( const auto& name : names ){
+    readers.emplace_back( new run_reader( name ) );
+  }
+  auto later = [&readers,before]( size_t a, size_t b ){
+    return before( *readers[b], *readers[a] );
+  };
+  priority_queue<size_t,vector<size_t>,decltype(later)> heap( later );
+  for ( size_t i=0; i < readers.size(); ++i ){
+    if ( readers[i]->good() ){
+      heap.push( i );
+    }
+  }
+  while ( !heap.empty() ){
+    size_t i = heap.top();
+    heap.pop();
+    sink( readers[i]->word(), readers[i]->freq() );
+    readers[i]->next();
+    if ( readers[i]->good() ){
+      heap.push( i );
+    }
+  }
+  readers.clear();
+  for ( const auto& name : names ){
+    remove( name.c_str() );
+  }
+}
+
+class word_summer {
+  // adds up the frequencies of consecutive equal words, before passing
+  // them on
+public:
+  explicit word_summer( function<void(const UnicodeString&,uint64_t)> out ):
+    _out( out ) {};
+  void add( const UnicodeString& word, uint64_t freq ){
+    if ( _have && word == _word ){
+      _freq += freq;
+    }
+    else {
+      flush();
+      _word = word;
+      _freq = freq;
+      _have = true;
+    }
+  };
+  void flush(){
+    if ( _have ){
+      _out( _word, _freq );
+      _have = false;
+    }
+  };
+private:
+  function<void(const UnicodeString&,uint64_t)> _out;
+  UnicodeString _word;
+  uint64_t _freq = 0;
+  bool _have = false; // a word is pending
+};
+
+template <class Before>
+vector<string> reduce_runs( vector<string> runs,
+			    Before before,
+			    bool sum,
+			    const string& prefix ){
+  // merge runs until at most MAX_FAN_IN are left
+  while ( runs.size() > MAX_FAN_IN ){
+    vector<string> group( runs.begin(), runs.begin() + MAX_FAN_IN );
+    run_writer out( run_name( prefix ) );
+    word_summer summer( [&out]( const UnicodeString& w, uint64_t f ){
+	out.add( w, f );
+      } );
+    merge_runs( group, before,
+		[&]( const UnicodeString& w, uint64_t f ){
+		  if ( sum ){
+		    summer.add( w, f );
+		  }
+		  else {
+		    out.add( w, f );
+		  }
+		} );
+    summer.flush();
+    runs.erase( runs.begin(), runs.begin() + MAX_FAN_IN );
+    runs.push_back( out.name() );
+  }
+  return runs;
+}
+
+string write_word_run( const ticcl::word_table& table, const string& prefix ){
+  run_writer out( run_name( prefix ) );
+  for ( auto id : table.sorted() ){
+    out.add( table.word( id ), table.count( id ) );
+  }
+  return out.name();
+}
+
+class freq_runs {
+  // collects the summed words, and writes them in runs sorted on frequency
+public:
+  freq_runs( size_t budget, const string& prefix ):
+    _budget( budget ), _prefix( prefix ) {};
+  void add( const UnicodeString& word, uint64_t freq ){
+    // the frequency is an unsigned int, as in create_wf_list()
+    _buffer.push_back( make_pair( (unsigned int)freq, word ) );
+    _used += entry_size( word );
+    if ( _used > _budget ){
+      flush();
+    }
+  };
+  void flush(){
+    if ( _buffer.empty() ){
+      return;
+    }
+    sort( _buffer.begin(), _buffer.end(),
+	  []( const pair<unsigned int,UnicodeString>& a,
+	      const pair<unsigned int,UnicodeString>& b ){
+	    return a.first > b.first
+	      || ( a.first == b.first && a.second < b.second );
+	  } );
+    run_writer out( run_name( _prefix ) );
+    for ( const auto& it : _buffer ){
+      out.add( it.second, it.first );
+    }
+    _runs.push_back( out.name() );
+    _buffer.clear();
+    _used = 0;
+  };
+  const vector<string>& runs() const { return _runs; };
+private:
+  size_t _budget;
+  string _prefix;
+  size_t _used = 0;
+  vector<pair<unsigned int,UnicodeString>> _buffer;
+  vector<string> _runs;
+};
+
+vector<string> count_runs( const vector<string>& file_names,
+			   size_t budget,
+			   const string& out_prefix,
+			   unsigned int& total ){
+  // count all lexicons into runs sorted on the words
+  size_t to_do = file_names.size();
+  unsigned int word_total = 0;
+  vector<string> word_runs;
+#pragma omp parallel shared(file_names,word_runs) reduction(+:word_total)
+  {
+    // every thread counts in a table of its own, within its share of
+    // the budget
+    size_t my_budget = budget;
+#ifdef HAVE_OPENMP
+    my_budget /= omp_get_num_threads();
+#endif
+    unique_ptr<ticcl::word_table> table( new ticcl::word_table() );
+    size_t used = 0;
+    auto flush = [&](){
+      if ( !table->empty() ){
+	string run = write_word_run( *table, out_prefix );
+#pragma omp critical (word_runs)
+	{
+	  word_runs.push_back( run );
+	}
+	table.reset( new ticcl::word_table() );
+	used = 0;
+      }
+    };
+#pragma omp for schedule(dynamic)
+    for ( size_t fn=0; fn < file_names.size(); ++fn ){
+      string doc_name = file_names[fn];
+      unsigned int word_count
+	= read_words( doc_name,
+		      [&]( const UnicodeString& wrd, size_t frq ){
+			size_t before = table->size();
+			uint32_t id = table->intern( wrd );
+			table->set_count( id, table->count( id ) + frq );
+			if ( table->size() > before ){
+			  used += entry_size( wrd );
+			  if ( used > my_budget ){
+			    flush();
+			  }
+			}
+		      } );
+      word_total += word_count;
+#pragma omp critical
+      {
+	cout << "Processed :" << doc_name << " with " << word_count << " words,"
+	     << " still " << --to_do << " files to go." << endl;
+      }
+    }
+    flush();
+  }
+  total = word_total;
+  return word_runs;
+}
+
+void output_runs( vector<string> word_runs,
+		  size_t budget,
+		  const string& out_prefix,
+		  const string& file_name,
+		  unsigned int word_total,
+		  bool doperc ){
+  if ( verbose ){
+    cout << "merging " << word_runs.size() << " runs" << endl;
+  }
+  word_runs = reduce_runs( word_runs, by_word, true, out_prefix );
+  freq_runs sorter( budget, out_prefix );
+  word_summer summer( [&sorter]( const UnicodeString& w, uint64_t f ){
+      sorter.add( w, f );
+    } );
+  merge_runs( word_runs, by_word,
+	      [&summer]( const UnicodeString& w, uint64_t f ){
+		summer.add( w, f );
+	      } );
+  summer.flush();
+  sorter.flush();
+  vector<string> runs = reduce_runs( sorter.runs(), by_freq, false, out_prefix );
+  ofstream os( file_name );
+  if ( !os ){
+    cerr << "failed to create outputfile '" << file_name << "'" << endl;
+    exit(EXIT_FAILURE);
+  }
+  unsigned int sum=0;
+  unsigned int types=0;
+  merge_runs( runs, by_freq,
+	      [&]( const UnicodeString& w, uint64_t f ){
+		unsigned int freq = f;
+		sum += freq;
+		os << w << "\t" << freq;
+		if ( doperc ){
+		  os << "\t" << sum << "\t" << 100 * double(sum)/word_total;
+		}
+		os << endl;
+		++types;
+	      } );
+  cout << "created WordFreq list '" << file_name << "'" << endl
+       << "with " << word_total << " tokens and " << types
+       << " types. TTR= " << (double)types/word_total
+       << ", the angle is " << atan((double)types/word_total)*180/M_PI
+       << " degrees" << endl;
+}
 
 void usage( const string& name ){
   cerr << "Usage: " << name << " [options] file/dir" << endl;
@@ -120,13 +455,15 @@ void usage( const string& name ){
   cerr << "\t-t <threads> or --threads <threads> Number of threads to run on." << endl;
   cerr << "\t\t If 'threads' has the value \"max\", the number of threads is set to a" << endl;
   cerr << "\t\t reasonable value. (OMP_NUM_TREADS - 2)" << endl;
+  cerr << "\t--memory=<MB>\t merge on disk, using about 'MB' megabytes of memory" << endl;
+  cerr << "\t\t for the words. Temporary files are created next to the output." << endl;
   cerr << "\t-v\t very verbose output." << endl;
   cerr << "\t-h or --help\t this message" << endl;
   cerr << "\t-V or --version\t show version " << endl;
 }
 
 int main( int argc, const char *argv[] ){
-  CL_Options opts( "hVve:t:o:Rp", "threads:,help,version" );
+  CL_Options opts( "hVve:t:o:Rp", "threads:,help,version,memory:" );
   try {
     opts.init(argc,argv);
   }
@@ -185,6 +522,14 @@ int main( int argc, const char *argv[] ){
 
   opts.extract('e', expression );
   bool dopercentage = opts.extract('p');
+  size_t budget = 0;
+  if ( opts.extract( "memory", value ) ){
+    if ( !TiCC::stringTo( value, budget ) || budget == 0 ){
+      cerr << "illegal value for --memory (" << value << ")" << endl;
+      exit( EXIT_FAILURE );
+    }
+    budget *= 1024*1024;
+  }
   if ( !opts.empty() ){
     cerr << "unsupported options : " << opts.toString() << endl;
     usage(progname);
@@ -232,12 +577,30 @@ int main( int argc, const char *argv[] ){
   if ( to_do > 1 ){
     cout << "start processing of " << to_do << " files " << endl;
   }
-  map<UnicodeString,unsigned int> wc;
+  if ( budget > 0 ){
+    unsigned int word_total = 0;
+    vector<string> runs = count_runs( file_names, budget, out_prefix,
+				      word_total );
+    if ( !dir_name.empty() ){
+      cout << "done processsing directory '" << dir_name << "' in total "
+	   << word_total << " words were found." << endl;
+    }
+    cout << "start outputting the results" << endl;
+    string file_name = out_prefix + ".wordfreqlist.tsv";
+    output_runs( runs, budget, out_prefix, file_name, word_total,
+		 dopercentage );
+    exit( EXIT_SUCCESS );
+  }
+  ticcl::word_counter wc;
   unsigned int word_total =0;
-#pragma omp parallel for shared(file_names,word_total,wc)
+#pragma omp parallel for shared(file_names,wc) reduction(+:word_total)
   for ( size_t fn=0; fn < file_names.size(); ++fn ){
     string doc_name = file_names[fn];
-    unsigned int word_count = read_words( doc_name, wc );
+    unsigned int word_count
+      = read_words( doc_name,
+		    [&wc]( const UnicodeString& wrd, size_t frq ){
+		      wc.add( wrd, frq );
+		    } );
     word_total += word_count;
 #pragma omp critical
     {
@@ -251,6 +614,6 @@ int main( int argc, const char *argv[] ){
   }
   cout << "start outputting the results" << endl;
   string file_name = out_prefix + ".wordfreqlist.tsv";
-  create_wf_list( wc, file_name, word_total, dopercentage );
+  create_wf_list( wc.merge(), file_name, word_total, dopercentage );
   exit( EXIT_SUCCESS );
 }
@@ -31,12 +31,20 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "ticcutils/CommandLine.h"
 #include "ticcutils/FileUtils.h"
 #include "ticcutils/StringOps.h"
 #include "ticcutils/XMLtools.h"
+#include "libxml/xmlreader.h"
 #include "ticcutils/Unicode.h"
+#include "unicode/ustring.h"
+#include "ticcl/ticcl_common.h"
 
 #include "config.h"
 #ifdef HAVE_OPENMP
@@ -48,7 +56,7 @@ using namespace	TiCC;
 
 bool verbose = false;
 
-void create_wf_list( const map<UnicodeString, unsigned int>& wc,
+void create_wf_list( const ticcl::word_table& wc,
 		     const string& filename, unsigned int totalIn,
 		     unsigned int clip,
 		     bool doperc ){
@@ -59,7 +67,9 @@ void create_wf_list( const map<UnicodeString, unsigned int>& wc,
     exit(EXIT_FAILURE);
   }
   map<unsigned int, set<UnicodeString> > fws;
-  for ( const auto& [word,freq] : wc ){
+  for ( uint32_t id=0; id < wc.size(); ++id ){
+    const unsigned int freq = wc.count( id );
+    const UnicodeString word = wc.word( id );
     if ( freq <= clip ){
       total -= freq;
     }
@@ -109,16 +119,83 @@ bool is_emph( const UnicodeString& data ){
   return (data.length() < 2) && u_isalnum(data[0]);
 }
 
-size_t tel( const xmlNode *node, bool lowercase,
-	    size_t ngram, const UnicodeString& sep,
-	    map<UnicodeString, unsigned int>& wc,
-	    set<UnicodeString>& emps ){
-  vector<UnicodeString> buffer(ngram);
-  size_t cnt = 0;
+struct text_window {
+  // the n-gram window and the emphasis state for the text of one XML
+  // element. Text in sub-elements uses a window of its own.
+  explicit text_window( size_t ngram ): buffer(ngram) {};
+  vector<UnicodeString> buffer;
   size_t buf_cnt = 0;
   bool in_emph = false;
   UnicodeString emph_start;
   UnicodeString emph_word;
+};
+
+inline void add_gram( ticcl::word_counter& wc, const UnicodeString& gram ){
+  wc.add( gram );
+}
+
+inline void add_gram( ticcl::word_table& wt, const UnicodeString& gram ){
+  uint32_t id = wt.intern( gram );
+  wt.set_count( id, wt.count( id ) + 1 );
+}
+
+template <class Counter>
+size_t count_text( const UnicodeString& line,
+		   text_window& win,
+		   bool lowercase,
+		   const UnicodeString& sep,
+		   Counter& wc,
+		   set<UnicodeString>& emps ){
+  const size_t ngram = win.buffer.size();
+  size_t cnt = 0;
+  vector<UnicodeString> v = TiCC::split( line );
+  for ( const auto& word : v ){
+    UnicodeString wrd = word;
+    if ( lowercase ){
+      wrd.toLower();
+    }
+    if ( is_emph( wrd ) ){
+      if ( win.in_emph ){
+	win.emph_word += "_" + wrd;
+      }
+      else {
+	win.emph_start = wrd;
+	win.in_emph = true;
+      }
+    }
+    else {
+      if ( win.in_emph && !win.emph_word.isEmpty() ){
+#pragma omp critical (hemp)
+	{
+	  emps.insert( win.emph_start + win.emph_word );
+	}
+      }
+      win.in_emph = false;
+      win.emph_start.remove();
+      win.emph_word.remove();
+    }
+    win.buffer[win.buf_cnt++] = wrd;
+    if ( win.buf_cnt == ngram ){
+      win.buf_cnt = ngram-1;
+      UnicodeString gram;
+      for( size_t i=0; i < ngram -1; ++i ){
+	gram += win.buffer[i] + sep;
+	win.buffer[i] = win.buffer[i+1];
+      }
+      gram += win.buffer[ngram-1];
+      add_gram( wc, gram );
+      ++cnt;
+    }
+  }
+  return cnt;
+}
+
+size_t tel( const xmlNode *node, bool lowercase,
+	    size_t ngram, const UnicodeString& sep,
+	    ticcl::word_counter& wc,
+	    set<UnicodeString>& emps ){
+  text_window win( ngram );
+  size_t cnt = 0;
   const xmlNode *pnt = node->children;
   while ( pnt ){
     //    cerr << "bekijk label: " << (char*)pnt->name << endl;
@@ -126,45 +203,7 @@ size_t tel( const xmlNode *node, bool lowercase,
     if ( pnt->type == XML_TEXT_NODE ){
       UnicodeString line  = TiCC::UnicodeFromUTF8( TiCC::TextValue( pnt ) );
       //      cerr << "text: " << line << endl;
-      vector<UnicodeString> v = TiCC::split( line );
-      for ( const auto& word : v ){
-	UnicodeString wrd = word;
-	if ( lowercase ){
-	  wrd.toLower();
-	}
-	if ( is_emph( wrd ) ){
-	  if ( in_emph ){
-	    emph_word += "_" + wrd;
-	  }
-	  else {
-	    emph_start = wrd;
-	    in_emph = true;
-	  }
-	}
-	else {
-	  if ( in_emph && !emph_word.isEmpty() ){
-	    emps.insert( emph_start + emph_word );
-	  }
-	  in_emph = false;
-	  emph_start.remove();
-	  emph_word.remove();
-	}
-	buffer[buf_cnt++] = wrd;
-	if ( buf_cnt == ngram ){
-	  buf_cnt = ngram-1;
-	  UnicodeString gram;
-	  for( size_t i=0; i < ngram -1; ++i ){
-	    gram += buffer[i] + sep;
-	    buffer[i] = buffer[i+1];
-	  }
-	  gram+= buffer[ngram-1];
-#pragma omp critical
-	  {
-	    ++wc[gram];
-	  }
-	  ++cnt;
-	}
-      }
+      cnt += count_text( line, win, lowercase, sep, wc, emps );
     }
     pnt = pnt->next;
   }
@@ -175,7 +214,7 @@ size_t word_xml_inventory( const string& docName,
 			   bool lowercase,
 			   size_t ngram,
 			   const UnicodeString& sep,
-			   map<UnicodeString,unsigned int>& wc,
+			   ticcl::word_counter& wc,
 			   set<UnicodeString>& emps ){
   xmlDoc *d = 0;
   int cnt = 0;
@@ -194,32 +233,206 @@ size_t word_xml_inventory( const string& docName,
   return wordTotal;
 }
 
-size_t word_inventory( const string& docName,
-		       bool lowercase,
-		       size_t ngram,
-		       const UnicodeString& sep,
-		       map<UnicodeString,unsigned int>& wc,
-		       set<UnicodeString>& emps,
-		       bool dolines ){
-  vector<UnicodeString> buffer(ngram);
-  size_t buf_cnt = 0;
+size_t word_xml_stream( const string& docName,
+			bool lowercase,
+			size_t ngram,
+			const UnicodeString& sep,
+			ticcl::word_counter& wc,
+			set<UnicodeString>& emps ){
+  // the same as word_xml_inventory(), but the document is streamed
+  // through an xmlTextReader, so it is never completely in memory.
+  // Every open element has its own window, as in tel().
+  // The n-grams are counted in a table of their own first, so a document
+  // with an error somewhere halfway adds nothing, like before.
+  int cnt = 0;
+  xmlTextReader *reader = xmlReaderForFile( docName.c_str(), 0,
+					    XML_PARSE_NOBLANKS|XML_PARSE_HUGE );
+  if ( !reader ){
+#pragma omp critical
+    {
+      cerr << "failed to load document '" << docName << "'" << endl;
+    }
+    return 0;
+  }
+  xmlTextReaderSetStructuredErrorHandler( reader,
+					  (xmlStructuredErrorFunc)error_sink,
+					  &cnt );
+  ticcl::word_table counts;
   size_t wordTotal = 0;
-  ifstream is( docName );
-  UnicodeString line;
+  vector<text_window> open;
+  int ret;
+  while ( ( ret = xmlTextReaderRead( reader ) ) == 1 && cnt == 0 ){
+    switch ( xmlTextReaderNodeType( reader ) ){
+    case XML_READER_TYPE_ELEMENT:
+      if ( !xmlTextReaderIsEmptyElement( reader ) ){
+	open.emplace_back( ngram );
+      }
+      break;
+    case XML_READER_TYPE_END_ELEMENT:
+      if ( !open.empty() ){
+	open.pop_back();
+      }
+      break;
+    case XML_READER_TYPE_TEXT:
+      if ( !open.empty() ){
+	const xmlChar *txt = xmlTextReaderConstValue( reader );
+	if ( txt ){
+	  UnicodeString line = TiCC::UnicodeFromUTF8( (const char*)txt );
+	  wordTotal += count_text( line, open.back(), lowercase, sep,
+				   counts, emps );
+	}
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  xmlFreeTextReader( reader );
+  if ( ret != 0 || cnt > 0 ){
+#pragma omp critical
+    {
+      cerr << "failed to load document '" << docName << "'" << endl;
+    }
+    return 0;
+  }
+  for ( uint32_t id=0; id < counts.size(); ++id ){
+    wc.add( counts.word( id ), counts.count( id ) );
+  }
+  return wordTotal;
+}
+
+class mapped_text {
+  // a read-only memory map of a (UTF-8) text file. The tokenizer works
+  // on the mapped bytes directly, without reading lines into strings.
+public:
+  explicit mapped_text( const string& );
+  ~mapped_text();
+  mapped_text( const mapped_text& ) = delete;
+  mapped_text& operator=( const mapped_text& ) = delete;
+  bool good() const { return _good; };
+  const char *data() const { return _data; };
+  size_t size() const { return _size; };
+private:
+  const char *_data = 0;
+  size_t _size = 0;
+  bool _good = false;
+};
+
+mapped_text::mapped_text( const string& name ){
+  int fd = open( name.c_str(), O_RDONLY );
+  if ( fd < 0 ){
+    return;
+  }
+  struct stat st;
+  if ( fstat( fd, &st ) == 0 ){
+    _size = st.st_size;
+    if ( _size == 0 ){
+      _good = true;
+    }
+    else {
+      void *map = mmap( 0, _size, PROT_READ, MAP_PRIVATE, fd, 0 );
+      if ( map != MAP_FAILED ){
+	madvise( map, _size, MADV_SEQUENTIAL );
+	_data = static_cast<const char*>(map);
+	_good = true;
+      }
+    }
+  }
+  ::close( fd );
+}
+
+mapped_text::~mapped_text(){
+  if ( _data ){
+    munmap( const_cast<char*>(_data), _size );
+  }
+}
+
+inline bool is_space( char c ){
+  // the separators of TiCC::split(). These are ASCII, so they never occur
+  // inside a multibyte UTF-8 sequence
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void utf8_token( const char *s, size_t len, UnicodeString& us ){
+  // convert a UTF-8 token into 'us', reusing the buffer it already has.
+  // Invalid sequences become U+FFFD, like TiCC::UnicodeFromUTF8() does.
+  // A UTF-8 string never has less bytes than its UTF-16 form has units.
+  UErrorCode err = U_ZERO_ERROR;
+  int32_t out = 0;
+  UChar *buf = us.getBuffer( len );
+  u_strFromUTF8WithSub( buf, us.getCapacity(), &out, s, len,
+			0xfffd, 0, &err );
+  us.releaseBuffer( U_SUCCESS(err) ? out : 0 );
+}
+
+UnicodeString make_gram( const vector<UnicodeString>& words,
+			 size_t start,
+			 size_t ngram,
+			 const UnicodeString& sep ){
+  UnicodeString gram;
+  for( size_t i=start; i < start + ngram - 1; ++i ){
+    gram += words[i] + sep;
+  }
+  gram += words[start+ngram-1];
+  return gram;
+}
+
+struct text_chunk {
+  // a line aligned byte range [begin,end) of a text file.
+  // When n-grams may cross line boundaries, we also keep the first and
+  // the last ngram-1 words, to build the n-grams spanning this chunk's
+  // boundaries afterwards
+  size_t begin = 0;
+  size_t end = 0;
+  size_t words = 0;
+  size_t grams = 0;
+  vector<UnicodeString> head;
+  vector<UnicodeString> tail;
+};
+
+void chunk_inventory( const char *text,
+		      text_chunk& chunk,
+		      bool lowercase,
+		      size_t ngram,
+		      const UnicodeString& sep,
+		      ticcl::word_counter& wc,
+		      bool dolines,
+		      set<UnicodeString> *emps ){
+  // tokenize the chunk in place. The last ngram words are kept in a ring,
+  // so every token is converted only once, and the string buffers are
+  // reused for the next tokens
+  const bool stitch = !dolines && ngram > 1;
+  vector<UnicodeString> ring(ngram);
+  size_t next = 0;
+  size_t filled = 0;
+  UnicodeString gram;
   bool in_emph = false;
   UnicodeString emph_start;
   UnicodeString emph_word;
-  while ( TiCC::getline( is, line ) ){
-    if ( dolines ){
-      buffer.clear();
-      buf_cnt = 0;
-    }
-    vector<UnicodeString> v = TiCC::split( line );
-    for ( const auto& word : v ){
-      UnicodeString wrd = word;
-      if ( lowercase ){
-	wrd.toLower();
+  const char *pnt = text + chunk.begin;
+  const char *end = text + chunk.end;
+  while ( pnt < end ){
+    if ( *pnt == '\n' ){
+      if ( dolines ){
+	filled = 0;
       }
+      ++pnt;
+      continue;
+    }
+    if ( is_space( *pnt ) ){
+      ++pnt;
+      continue;
+    }
+    const char *start = pnt;
+    while ( pnt < end && !is_space( *pnt ) ){
+      ++pnt;
+    }
+    UnicodeString& wrd = ring[next];
+    utf8_token( start, pnt - start, wrd );
+    if ( lowercase ){
+      wrd.toLower();
+    }
+    if ( emps ){
       if ( is_emph( wrd ) ){
 	if ( in_emph ){
 	  emph_word += "_" + wrd;
@@ -231,32 +444,148 @@ size_t word_inventory( const string& docName,
       }
       else {
 	if ( in_emph && !emph_word.isEmpty() ){
-	  emps.insert( emph_start + emph_word );
+#pragma omp critical (hemp)
+	  {
+	    emps->insert( emph_start + emph_word );
+	  }
 	}
 	in_emph = false;
 	emph_start.remove();
 	emph_word.remove();
       }
-      buffer[buf_cnt++] = wrd;
-      if ( buf_cnt == ngram ){
-	buf_cnt = ngram-1;
-	UnicodeString gram;
-	for( size_t i=0; i < ngram -1; ++i ){
-	  gram += buffer[i] + sep;
-	  buffer[i] = buffer[i+1];
+    }
+    ++chunk.words;
+    if ( stitch ){
+      if ( chunk.head.size() < ngram-1 ){
+	chunk.head.push_back( wrd );
+      }
+      chunk.tail.push_back( wrd );
+      if ( chunk.tail.size() > ngram-1 ){
+	chunk.tail.erase( chunk.tail.begin() );
+      }
+    }
+    next = ( next + 1 ) % ngram;
+    if ( filled < ngram ){
+      ++filled;
+    }
+    if ( filled == ngram ){
+      if ( ngram == 1 ){
+	wc.add( wrd );
+      }
+      else {
+	// the oldest word is at 'next' now
+	gram.remove();
+	for ( size_t i=0; i < ngram; ++i ){
+	  if ( i > 0 ){
+	    gram += sep;
+	  }
+	  gram += ring[(next+i)%ngram];
 	}
-	gram += buffer[ngram-1];
+	wc.add( gram );
+      }
+      ++chunk.grams;
+    }
+  }
+}
+
+size_t word_inventory( const string& docName,
+		       bool lowercase,
+		       size_t ngram,
+		       const UnicodeString& sep,
+		       ticcl::word_counter& wc,
+		       set<UnicodeString>& emps,
+		       bool dolines ){
+  mapped_text text( docName );
+  if ( !text.good() ){
 #pragma omp critical
-	{
-	  ++wc[gram];
-	}
-	++wordTotal;
+    {
+      cerr << "unable to read '" << docName << "'" << endl;
+    }
+    return 0;
+  }
+  text_chunk all;
+  all.end = text.size();
+  chunk_inventory( text.data(), all, lowercase, ngram, sep, wc, dolines, &emps );
+  return all.grams;
+}
+
+vector<text_chunk> split_text( const mapped_text& text,
+			       size_t chunk_size ){
+  // cut the text in ranges of at least chunk_size bytes,
+  // each ending just after a newline (or at the end of the text)
+  vector<text_chunk> result;
+  size_t begin = 0;
+  while ( begin < text.size() ){
+    text_chunk chunk;
+    chunk.begin = begin;
+    chunk.end = text.size();
+    if ( text.size() - begin > chunk_size ){
+      const char *nl = static_cast<const char*>
+	( memchr( text.data() + begin + chunk_size,
+		  '\n',
+		  text.size() - begin - chunk_size ) );
+      if ( nl ){
+	chunk.end = nl - text.data() + 1;
       }
     }
+    result.push_back( chunk );
+    begin = chunk.end;
   }
-  return wordTotal;
+  return result;
 }
 
+size_t split_inventory( const string& docName,
+			size_t chunk_size,
+			bool lowercase,
+			size_t ngram,
+			const UnicodeString& sep,
+			ticcl::word_counter& wc,
+			bool dolines ){
+  // count one large text file using all threads. Every chunk counts the
+  // n-grams that start AND end inside it. The n-grams crossing a chunk
+  // boundary are added afterwards, walking the chunks in file order.
+  mapped_text text( docName );
+  if ( !text.good() ){
+    cerr << "unable to read '" << docName << "'" << endl;
+    return 0;
+  }
+  vector<text_chunk> chunks = split_text( text, chunk_size );
+#pragma omp parallel for schedule(dynamic) shared(chunks,wc)
+  for ( size_t i=0; i < chunks.size(); ++i ){
+    chunk_inventory( text.data(), chunks[i], lowercase, ngram, sep, wc,
+		     dolines, 0 );
+  }
+  size_t wordTotal = 0;
+  for ( const auto& chunk : chunks ){
+    wordTotal += chunk.grams;
+  }
+  if ( dolines || ngram == 1 ){
+    // no n-gram crosses a line, so neither a chunk boundary
+    return wordTotal;
+  }
+  vector<UnicodeString> carry; // the last ngram-1 words seen so far
+  for ( const auto& chunk : chunks ){
+    vector<UnicodeString> joined = carry;
+    joined.insert( joined.end(), chunk.head.begin(), chunk.head.end() );
+    for ( size_t start=0;
+	  start < carry.size() && start + ngram <= joined.size();
+	  ++start ){
+      wc.add( make_gram( joined, start, ngram, sep ) );
+      ++wordTotal;
+    }
+    if ( chunk.words >= ngram-1 ){
+      carry = chunk.tail;
+    }
+    else {
+      // a tiny chunk, the head holds all of its words
+      if ( joined.size() > ngram-1 ){
+	joined.erase( joined.begin(), joined.end() - (ngram-1) );
+      }
+      carry = joined;
+    }
+  }
+  return wordTotal;
+}
 
 void usage( const string& name ){
   cerr << "Usage: " << name << " [options] file/dir" << endl;
@@ -275,17 +604,22 @@ void usage( const string& name ){
   cerr << "\t\t\t If 'threads' has the value \"max\", the number of threads is set to a" << endl;
   cerr << "\t\t\t reasonable value. (OMP_NUM_TREADS - 2)" << endl;
   cerr << "\t-n\t newlines delimit the input." << endl;
+  cerr << "\t--split=<MB>\t when running on more than 1 thread, process text files" << endl;
+  cerr << "\t\t\t larger than 'MB' megabytes in line aligned chunks of that size" << endl;
+  cerr << "\t\t\t on all threads. (default 64, 0 disables this)" << endl;
   cerr << "\t-v\t very verbose output." << endl;
   cerr << "\t-e expr\t specify the expression all input files should match with." << endl;
   cerr << "\t-o\t name of the output file(s) prefix." << endl;
   cerr << "\t-X\t the inputfiles are assumed to be XML. (all TEXT nodes are used)" << endl;
+  cerr << "\t--stream\t with -X: stream the XML files, instead of loading them" << endl;
+  cerr << "\t\t\t completely. Use this for (very) large files." << endl;
   cerr << "\t-R\t search the dirs recursively (when appropriate)." << endl;
   cerr << "\t-V or --version\t show version " << endl;
   cerr << "\t-h or --help \t this message." << endl;
 }
 
 int main( int argc, const char *argv[] ){
-  CL_Options opts( "hnVvpe:t:o:RX", "clip:,lower,ngram:,underscore,separator:,hemp:,threads:" );
+  CL_Options opts( "hnVvpe:t:o:RX", "clip:,lower,ngram:,underscore,separator:,hemp:,threads:,split:,stream" );
   try {
     opts.init(argc,argv);
   }
@@ -316,6 +650,11 @@ int main( int argc, const char *argv[] ){
   if ( doXML && dolines ){
     cerr << "options -X and -n conflict!" << endl;
   }
+  bool doStream = opts.extract( "stream" );
+  if ( doStream && !doXML ){
+    cerr << "option --stream is only useful together with -X" << endl;
+    exit(EXIT_FAILURE);
+  }
   bool dopercentage = opts.extract('p');
   bool lowercase = opts.extract("lower");
   bool recursiveDirs = opts.extract( 'R' );
@@ -359,12 +698,20 @@ int main( int argc, const char *argv[] ){
       exit(EXIT_FAILURE);
     }
   }
+  size_t split_size = 64;
+  if ( opts.extract("split", value ) ){
+    if ( !stringTo(value, split_size ) ){
+      cerr << "illegal value for --split (" << value << ")" << endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  split_size *= 1024*1024;
   value = "1";
   if ( !opts.extract( 't', value ) ){
     opts.extract( "threads", value );
   }
-#ifdef HAVE_OPENMP
   int numThreads=1;
+#ifdef HAVE_OPENMP
   if ( TiCC::lowercase(value) == "max" ){
     numThreads = omp_get_max_threads() - 2;
     omp_set_num_threads( numThreads );
@@ -428,16 +775,40 @@ int main( int argc, const char *argv[] ){
   if ( toDo > 1 ){
     cout << "start processing of " << toDo << " files " << endl;
   }
-  map<UnicodeString,unsigned int> wc;
+  ticcl::word_counter wc;
   unsigned int wordTotal =0;
 
   set<UnicodeString> hemp;
-#pragma omp parallel for shared(fileNames,wordTotal,wc,hemp)
+  vector<string> bigFiles;
+  if ( numThreads > 1
+       && split_size > 0
+       && !doXML
+       && hempName.empty() ){
+    // large text files are split over all threads, instead of
+    // handing each of them to just one thread
+    vector<string> smallFiles;
+    for ( const auto& docName : fileNames ){
+      ifstream is( docName, ios::binary|ios::ate );
+      if ( is && size_t(is.tellg()) > split_size ){
+	bigFiles.push_back( docName );
+      }
+      else {
+	smallFiles.push_back( docName );
+      }
+    }
+    fileNames = smallFiles;
+  }
+#pragma omp parallel for shared(fileNames,wc,hemp) reduction(+:wordTotal)
   for ( size_t fn=0; fn < fileNames.size(); ++fn ){
     string docName = fileNames[fn];
     unsigned int word_count =  0;
     if ( doXML ){
-      word_count = word_xml_inventory( docName, lowercase, ngram, sep, wc, hemp );
+      if ( doStream ){
+	word_count = word_xml_stream( docName, lowercase, ngram, sep, wc, hemp );
+      }
+      else {
+	word_count = word_xml_inventory( docName, lowercase, ngram, sep, wc, hemp );
+      }
     }
     else {
       word_count = word_inventory( docName, lowercase, ngram, sep, wc, hemp, dolines );
@@ -449,6 +820,14 @@ int main( int argc, const char *argv[] ){
 	   << " still " << --toDo << " files to go." << endl;
     }
   }
+  for ( const auto& docName : bigFiles ){
+    unsigned int word_count = split_inventory( docName, split_size,
+					       lowercase, ngram, sep, wc,
+					       dolines );
+    wordTotal += word_count;
+    cout << "Processed :" << docName << " with " << word_count << " words,"
+	 << " still " << --toDo << " files to go." << endl;
+  }
   if ( toDo > 1 ){
     cout << "done processsing directory '" << name << "' in total "
 	 << wordTotal << " words were found." << endl;
@@ -461,6 +840,6 @@ int main( int argc, const char *argv[] ){
     }
     cout << "historical emphasis stored in: " << hempName << endl;
   }
-  create_wf_list( wc, wf_filename, wordTotal, clip, dopercentage );
+  create_wf_list( wc.merge(), wf_filename, wordTotal, clip, dopercentage );
   exit( EXIT_SUCCESS );
 }
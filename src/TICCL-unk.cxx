@@ -471,7 +471,7 @@ UnicodeString filter_punct( const UnicodeString& us ){
 S_Class classify_n_gram( const vector<UnicodeString>& parts,
 			 UnicodeString& end_pun,
 			 unsigned int& lexclean,
-			 const map<UnicodeString,unsigned int>& decap_clean_words,
+			 const ticcl::lexicon& background,
 			 const set<UChar>& alphabet ){
   if ( verbose ){
     cerr << "classify a " << parts.size() << "-gram" << endl;
@@ -497,7 +497,7 @@ S_Class classify_n_gram( const vector<UnicodeString>& parts,
     UnicodeString pun;
     UnicodeString us = wrd;
     us.toLower();
-    if ( decap_clean_words.find( us ) != decap_clean_words.end() ){
+    if ( background.find_low( us ) != ticcl::word_table::npos ){
       // no need to do a lot of work for already clean words
       ++lexclean;
       if ( verbose ){
@@ -509,7 +509,7 @@ S_Class classify_n_gram( const vector<UnicodeString>& parts,
       cl = classify( wrd, alphabet, pun );
       UnicodeString l_pun = pun;
       l_pun.toLower();
-      if ( decap_clean_words.find( l_pun ) != decap_clean_words.end() ){
+      if ( background.find_low( l_pun ) != ticcl::word_table::npos ){
 	// so the depunct word is lexically clean
 	++lexclean;
 	if ( verbose ){
@@ -608,9 +608,9 @@ S_Class classify_n_gram( const vector<UnicodeString>& parts,
 }
 
 void classify_one_entry( const UnicodeString& orig_word, unsigned int freq,
-			 map<UnicodeString,unsigned int>& clean_words,
-			 const map<UnicodeString,unsigned int>& decap_clean_words,
-			 map<UnicodeString,unsigned int>& unk_words,
+			 ticcl::lexicon& clean_words,
+			 const ticcl::lexicon& background,
+			 ticcl::lexicon& unk_words,
 			 map<UnicodeString,UnicodeString>& punct_words,
 			 map<UnicodeString,unsigned int>& punct_acro_words,
 			 map<UnicodeString,unsigned int>& compound_acro_words,
@@ -653,17 +653,17 @@ void classify_one_entry( const UnicodeString& orig_word, unsigned int freq,
   unsigned int lexclean = 0;
   UnicodeString end_pun;
   S_Class end_cl = classify_n_gram( parts, end_pun,
-				    lexclean, decap_clean_words, alphabet );
+				    lexclean, background, alphabet );
 
   switch ( end_cl ){
   case IGNORE:
     break;
   case CLEAN:
     {
-      clean_words[word] += freq;
-      if ( clean_words[word] < artifreq
+      uint32_t id = clean_words.add( word );
+      if ( clean_words.add_freq( id, freq ) < artifreq
 	   && lexclean == parts.size() ){
-	clean_words[word] += artifreq;
+	clean_words.add_freq( id, artifreq );
       }
       if ( normalized ){
 	punct_words[orig_word] = word;
@@ -695,7 +695,7 @@ void classify_one_entry( const UnicodeString& orig_word, unsigned int freq,
 	if ( verbose ){
 	  cerr << "UNK ACRO: " << word << endl;
 	}
-	clean_words[word] += freq;
+	clean_words.add_freq( clean_words.add( word ), freq );
 	punct_acro_words[word] += freq;
       }
       else if ( doAcro && isAcro( parts, acros ) ){
@@ -710,7 +710,7 @@ void classify_one_entry( const UnicodeString& orig_word, unsigned int freq,
 	if ( verbose ){
 	  cerr << "UNK word: " << orig_word << endl;
 	}
-	unk_words[orig_word] += freq;
+	unk_words.add_freq( unk_words.add( orig_word ), freq );
       }
     }
     break;
@@ -723,7 +723,7 @@ void classify_one_entry( const UnicodeString& orig_word, unsigned int freq,
 	}
 	punct_acro_words[end_pun] += freq;
 	punct_words[end_pun] = word;
-	clean_words[word] += freq;
+	clean_words.add_freq( clean_words.add( word ), freq );
       }
       else if ( doAcro && isAcro( parts, acros ) ){
 	for ( const auto& acro : acros ){
@@ -737,10 +737,10 @@ void classify_one_entry( const UnicodeString& orig_word, unsigned int freq,
 	if ( verbose ){
 	  cerr << "PUNCT word: " << word << " depunct to: " << end_pun << endl;
 	}
-	clean_words[end_pun] += freq;
-	if ( clean_words[end_pun] < artifreq
+	uint32_t id = clean_words.add( end_pun );
+	if ( clean_words.add_freq( id, freq ) < artifreq
 	     && lexclean == parts.size() ){
-	  clean_words[end_pun] += artifreq;
+	  clean_words.add_freq( id, artifreq );
 	}
 	punct_words[orig_word] = end_pun;
       }
@@ -761,9 +761,9 @@ void format( const UnicodeString& line ){
   }
 }
 
-map<UnicodeString,unsigned int> read_back_lex( istream& is,
-					       size_t artifreq ){
-  map<UnicodeString,unsigned int> result;
+void read_back_lex( istream& is,
+		    size_t artifreq,
+		    ticcl::lexicon& result ){
   UnicodeString line;
   while ( TiCC::getline( is, line ) ){
     vector<UnicodeString> v = TiCC::split_at( line, "\t" );
@@ -788,13 +788,11 @@ map<UnicodeString,unsigned int> read_back_lex( istream& is,
     else {
       freq = artifreq;
     }
-    result[v[0]] = freq;
+    result.set_freq( result.add( v[0] ), freq );
   }
-  return result;
 }
 
-map<UnicodeString,unsigned> read_fore_lex( istream& is ){
-  map<UnicodeString,unsigned> result;
+void read_fore_lex( istream& is, ticcl::lexicon& result ){
   size_t err_cnt = 0;
   size_t line_cnt = 0 ;
   UnicodeString line;
@@ -821,9 +819,8 @@ map<UnicodeString,unsigned> read_fore_lex( istream& is ){
     }
 
     unsigned int freq = TiCC::stringTo<unsigned int>(v[1]);
-    result[v[0]] = freq;
+    result.set_freq( result.add( v[0] ), freq );
   }
-  return result;
 }
 
 UnicodeString default_filter = "æ >ae;"
@@ -864,6 +861,9 @@ void usage( const string& name ){
        << endl;
   cerr << "\t\t in the validated lexicon. (default = 0)" << endl;
   cerr << "\t--acro\t also create an acronyms file. (experimental)" << endl;
+  cerr << "\t--vocab\t also create a binary vocabulary file 'name'.clean.vocab" << endl;
+  cerr << "\t\t with the clean words and their frequencies, which can be used" << endl;
+  cerr << "\t\t instead of the .clean file by TICCL-LDcalc" << endl;
   cerr << "\t--filter='file'\t use rules from 'file' to transliterate  (experimental)" << endl;
   cerr << "\t\t see http://userguide.icu-project.org/transforms/general/rules for information about rules." << endl;
   cerr << "\t\t default the following filter is used: " << endl;
@@ -878,7 +878,7 @@ int main( int argc, const char *argv[] ){
   TiCC::CL_Options opts;
   try {
     opts.add_short_options( "vVho:" );
-    opts.add_long_options( "acro,alph:,corpus:,background:,artifrq:,filter:,help,version,hemp:" );
+    opts.add_long_options( "acro,alph:,corpus:,background:,artifrq:,filter:,help,version,hemp:,vocab" );
     opts.parse_args( argc, argv );
   }
   catch( TiCC::OptionError& e ){
@@ -903,6 +903,7 @@ int main( int argc, const char *argv[] ){
   string background_file;
   size_t artifreq = 0;
   bool doAcro = opts.extract("acro");
+  bool doVocab = opts.extract("vocab");
   verbose = opts.extract('v');
   opts.extract("background", background_file);
   if ( background_file.empty() ){
@@ -962,6 +963,7 @@ int main( int argc, const char *argv[] ){
   string all_clean_file_name = output_name + ".clean";
   string punct_file_name = output_name + ".punct";
   string acro_file_name = output_name + ".acro";
+  string vocab_file_name = all_clean_file_name + ".vocab";
 
   if ( !TiCC::createPath( all_clean_file_name ) ){
     cerr << "unable to open output file: " << all_clean_file_name << endl;
@@ -984,6 +986,14 @@ int main( int argc, const char *argv[] ){
     exit(EXIT_FAILURE);
   }
   ofstream punct_s( punct_file_name );
+  ofstream vocab_s;
+  if ( doVocab ){
+    vocab_s.open( vocab_file_name, ios::binary );
+    if ( !vocab_s ){
+      cerr << "unable to open output file: " << vocab_file_name << endl;
+      exit(EXIT_FAILURE);
+    }
+  }
   if ( doAcro ){
     if ( !TiCC::createPath( acro_file_name ) ){
       cerr << "unable to open output file: " << acro_file_name << endl;
@@ -1016,14 +1026,15 @@ int main( int argc, const char *argv[] ){
     cout << "reading Historical Emphases: " << hemp_file << endl;
     fillHemps( hs, hemps );
   }
-  map<UnicodeString,unsigned int> all_clean_words;
-  map<UnicodeString,unsigned int> fore_clean_words;
-  map<UnicodeString,unsigned int> decap_clean_words;
-  map<UnicodeString,unsigned int> unk_words;
+  ticcl::lexicon all_clean_words;
+  ticcl::lexicon fore_clean_words;
+  ticcl::lexicon unk_words;
   map<UnicodeString,unsigned int> punct_acro_words;
   map<UnicodeString,unsigned int> compound_acro_words;
   map<UnicodeString,UnicodeString> punct_words;
-  map<UnicodeString,unsigned int> back_lexicon;
+  // the lowercased view of the background lexicon tells which words
+  // are known to be clean
+  ticcl::lexicon back_lexicon;
   //  hemps.insert("F_1_o_r_e_n_t_ij_n_e_r.");
   if ( !hemps.empty() ){
     cout << "start classifying the Historical Emphases with "
@@ -1036,7 +1047,7 @@ int main( int argc, const char *argv[] ){
       }
       map<UnicodeString,UnicodeString> dummy_puncts;
       classify_one_entry( clean, 1,
-			  fore_clean_words, decap_clean_words,
+			  fore_clean_words, back_lexicon,
 			  unk_words, dummy_puncts,
 			  punct_acro_words, compound_acro_words,
 			  doAcro, alphabet, artifreq );
@@ -1061,38 +1072,44 @@ int main( int argc, const char *argv[] ){
       cerr << "unable to open background file: " << background_file << endl;
       exit(EXIT_FAILURE);
     }
-    back_lexicon = read_back_lex( extra, artifreq );
+    read_back_lex( extra, artifreq, back_lexicon );
     cout << "read a background lexicon with " << back_lexicon.size()
 	 << " entries." << endl;
 
-    for ( const auto& [word,freq] : back_lexicon ){
-      UnicodeString w = word;
-      all_clean_words[w] += freq;
-      w.toLower();
-      decap_clean_words[w] += freq;
+    for ( uint32_t id=0; id < back_lexicon.size(); ++id ){
+      const uint64_t freq = back_lexicon.freq( id );
+      all_clean_words.add_freq( all_clean_words.add( back_lexicon.word( id ) ),
+				freq );
+      const uint32_t low = back_lexicon.low_id( id );
+      back_lexicon.set_low_freq( low, back_lexicon.low_freq( low ) + freq );
     }
   }
-  map<UnicodeString,unsigned> fore_lexicon = read_fore_lex( is );
+  ticcl::lexicon fore_lexicon;
+  read_fore_lex( is, fore_lexicon );
   cout << "start classifying the foreground lexicon with "
        << fore_lexicon.size() << " entries"<< endl;
-  for ( const auto& [word,freq] : fore_lexicon ){
-    classify_one_entry( word, freq,
-			fore_clean_words, decap_clean_words,
+  // in alphabetical order, as the results may depend on it
+  for ( const auto id : fore_lexicon.sorted() ){
+    classify_one_entry( fore_lexicon.word( id ), fore_lexicon.freq( id ),
+			fore_clean_words, back_lexicon,
 			unk_words, punct_words,
 			punct_acro_words, compound_acro_words,
 			doAcro, alphabet, artifreq );
   }
   cout << "generating output files" << endl;
   cout << "using artifrq=" << artifreq << endl;
+  // the clean words, in the order of the .clean file
+  ticcl::word_table vocab;
   if ( !background_file.empty() ){
     ofstream fcs( fore_clean_file_name );
     map<unsigned int, set<UnicodeString> > fw;
-    for ( const auto& [word,f] : fore_clean_words ){
-      unsigned int freq = f;
-      auto back_it = back_lexicon.find( word );
-      if ( back_it != back_lexicon.end() ){
+    for ( uint32_t id=0; id < fore_clean_words.size(); ++id ){
+      const UnicodeString word = fore_clean_words.word( id );
+      unsigned int freq = fore_clean_words.freq( id );
+      auto back_id = back_lexicon.find( word );
+      if ( back_id != ticcl::word_table::npos ){
 	// add background frequency to the foreground
-	freq += back_it->second;
+	freq += back_lexicon.freq( back_id );
       }
       if ( freq > artifreq && (freq -  artifreq) > artifreq ){
       	freq -= artifreq;
@@ -1107,21 +1124,26 @@ int main( int argc, const char *argv[] ){
       ++wit;
     }
     cout << "created separate " << fore_clean_file_name << endl;
-    for ( auto& [word,freq] : fore_clean_words ){
-      unsigned int f1 = all_clean_words[word];
+    for ( uint32_t id=0; id < fore_clean_words.size(); ++id ){
+      unsigned int freq = fore_clean_words.freq( id );
+      uint32_t a_id = all_clean_words.add( fore_clean_words.word( id ) );
+      unsigned int f1 = all_clean_words.freq( a_id );
       if ( freq > artifreq && f1 >= artifreq ){
 	freq -= artifreq;
       }
-      all_clean_words[word] += freq;
+      all_clean_words.add_freq( a_id, freq );
     }
     fw.clear();
-    for ( const auto& [word,freq] : all_clean_words ){
-      fw[freq].insert( word );
+    for ( uint32_t id=0; id < all_clean_words.size(); ++id ){
+      fw[all_clean_words.freq( id )].insert( all_clean_words.word( id ) );
     }
     wit = fw.rbegin();
     while ( wit != fw.rend() ){
       for ( const auto& sit : wit->second ){
 	acs << sit << "\t" << wit->first << endl;
+	if ( doVocab ){
+	  vocab.set_count( vocab.intern( sit ), wit->first );
+	}
       }
       ++wit;
     }
@@ -1129,21 +1151,28 @@ int main( int argc, const char *argv[] ){
   }
   else {
     map<unsigned int, set<UnicodeString> > fw;
-    for ( const auto& [word,freq] : fore_clean_words ){
-      fw[freq].insert( word );
+    for ( uint32_t id=0; id < fore_clean_words.size(); ++id ){
+      fw[fore_clean_words.freq( id )].insert( fore_clean_words.word( id ) );
     }
     auto wit = fw.rbegin();
     while ( wit != fw.rend() ){
       for ( const auto& sit : wit->second ){
 	acs << sit << "\t" << wit->first << endl;
+	if ( doVocab ){
+	  vocab.set_count( vocab.intern( sit ), wit->first );
+	}
       }
       ++wit;
     }
     cout << "created " << all_clean_file_name << endl;
   }
+  if ( doVocab ){
+    vocab.write( vocab_s );
+    cout << "created " << vocab_file_name << endl;
+  }
   map<unsigned int, set<UnicodeString> > fw_out;
-  for ( const auto& [word,freq] : unk_words ){
-    fw_out[freq].insert( word );
+  for ( uint32_t id=0; id < unk_words.size(); ++id ){
+    fw_out[unk_words.freq( id )].insert( unk_words.word( id ) );
   }
   auto wit = fw_out.rbegin();
   while ( wit != fw_out.rend() ){
@@ -0,0 +1,227 @@
+/*
+  Copyright (c) 2026
+  CLST  - Radboud University
+
+  This file is part of ticcltools
+
+  ticcltools is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  ticcltools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/ticcltools/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include "ticcutils/StringOps.h"
+#include "ticcutils/Unicode.h"
+#include "ticcl/ticcl_common.h"
+
+using namespace std;
+using namespace icu;
+
+namespace ticcl {
+
+  static const char anahash_magic[8] = { 'T','I','C','C','L','A','H','1' };
+  static const uint64_t byte_order_mark = 0x0102030405060708ULL;
+
+  struct anahash_header {
+    char magic[8];
+    uint64_t order;
+    uint64_t n_hashes;
+    uint64_t n_words;
+    uint64_t pool_size;
+  };
+
+  anahash_file::anahash_file( const string& name ){
+    open( name );
+  }
+
+  anahash_file::~anahash_file(){
+    close();
+  }
+
+  void anahash_file::close(){
+    if ( _map ){
+      munmap( _map, _map_size );
+    }
+    _map = 0;
+    _map_size = 0;
+    _n_hashes = 0;
+    _n_words = 0;
+    _hashes = 0;
+    _word_start = 0;
+    _word_offs = 0;
+    _first_len = 0;
+    _pool = 0;
+  }
+
+  void anahash_file::open( const string& name ){
+    close();
+    int fd = ::open( name.c_str(), O_RDONLY );
+    if ( fd < 0 ){
+      throw runtime_error( "unable to open binary anagram hash file: "
+			   + name );
+    }
+    struct stat st;
+    if ( fstat( fd, &st ) != 0
+	 || size_t(st.st_size) < sizeof(anahash_header) ){
+      ::close( fd );
+      throw runtime_error( "invalid binary anagram hash file: " + name );
+    }
+    _map_size = st.st_size;
+    _map = mmap( 0, _map_size, PROT_READ, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if ( _map == MAP_FAILED ){
+      _map = 0;
+      _map_size = 0;
+      throw runtime_error( "unable to map binary anagram hash file: "
+			   + name );
+    }
+    const anahash_header *head = static_cast<const anahash_header*>(_map);
+    if ( memcmp( head->magic, anahash_magic, sizeof(anahash_magic) ) != 0
+	 || head->order != byte_order_mark ){
+      close();
+      throw runtime_error( "not a binary anagram hash file (or wrong byte order): " + name );
+    }
+    const size_t n = head->n_hashes;
+    const size_t m = head->n_words;
+    const size_t expected = sizeof(anahash_header)
+      + n * sizeof(bitType)
+      + (n+1) * sizeof(uint64_t)
+      + (m+1) * sizeof(uint64_t)
+      + n * sizeof(uint32_t)
+      + head->pool_size;
+    if ( expected != _map_size ){
+      close();
+      throw runtime_error( "corrupt binary anagram hash file: " + name );
+    }
+    const char *p = static_cast<const char*>(_map) + sizeof(anahash_header);
+    _hashes = reinterpret_cast<const bitType*>(p);
+    p += n * sizeof(bitType);
+    _word_start = reinterpret_cast<const uint64_t*>(p);
+    p += (n+1) * sizeof(uint64_t);
+    _word_offs = reinterpret_cast<const uint64_t*>(p);
+    p += (m+1) * sizeof(uint64_t);
+    _first_len = reinterpret_cast<const uint32_t*>(p);
+    p += n * sizeof(uint32_t);
+    _pool = p;
+    _n_hashes = n;
+    _n_words = m;
+    madvise( _map, _map_size, MADV_SEQUENTIAL );
+  }
+
+  UnicodeString anahash_file::word( size_t i, size_t j ) const {
+    string_view w = word_utf8( i, j );
+    return UnicodeString::fromUTF8( StringPiece( w.data(), w.size() ) );
+  }
+
+  bool is_anahash_bin( const string& name ){
+    ifstream is( name, ios::binary );
+    char magic[sizeof(anahash_magic)];
+    if ( !is.read( magic, sizeof(magic) ) ){
+      return false;
+    }
+    return memcmp( magic, anahash_magic, sizeof(magic) ) == 0;
+  }
+
+  void write_anahash_bin( ostream& os,
+			  const map<bitType,set<UnicodeString>>& anagrams ){
+    vector<bitType> hashes;
+    vector<uint64_t> word_start;
+    vector<uint64_t> word_offs;
+    vector<uint32_t> first_len;
+    string pool;
+    hashes.reserve( anagrams.size() );
+    word_start.reserve( anagrams.size() + 1 );
+    first_len.reserve( anagrams.size() );
+    for ( const auto& [val,str_set] : anagrams ){
+      hashes.push_back( val );
+      word_start.push_back( word_offs.size() );
+      first_len.push_back( str_set.empty() ? 0 : str_set.begin()->length() );
+      for ( const auto& s : str_set ){
+	word_offs.push_back( pool.size() );
+	s.toUTF8String( pool );
+      }
+    }
+    word_start.push_back( word_offs.size() );
+    anahash_header head;
+    memcpy( head.magic, anahash_magic, sizeof(anahash_magic) );
+    head.order = byte_order_mark;
+    head.n_hashes = hashes.size();
+    head.n_words = word_offs.size();
+    head.pool_size = pool.size();
+    word_offs.push_back( pool.size() );
+    os.write( reinterpret_cast<const char*>(&head), sizeof(head) );
+    os.write( reinterpret_cast<const char*>(hashes.data()),
+	      hashes.size() * sizeof(bitType) );
+    os.write( reinterpret_cast<const char*>(word_start.data()),
+	      word_start.size() * sizeof(uint64_t) );
+    os.write( reinterpret_cast<const char*>(word_offs.data()),
+	      word_offs.size() * sizeof(uint64_t) );
+    os.write( reinterpret_cast<const char*>(first_len.data()),
+	      first_len.size() * sizeof(uint32_t) );
+    os.write( pool.data(), pool.size() );
+    if ( !os ){
+      throw runtime_error( "problem writing binary anagram hash file" );
+    }
+  }
+
+  flat_set read_anahash( const anahash_file& ana,
+			 const int& low,
+			 const int& high,
+			 size_t& skipped,
+			 bool verbose ){
+    vector<bitType> result;
+    result.reserve( ana.size() );
+    for ( size_t i=0; i < ana.size(); ++i ){
+      // compare as int, like the text reader does, so a negative
+      // low or high value works the same for both formats
+      const int len = ana.first_length( i );
+      if ( len >= low && len <= high ){
+	result.push_back( ana.hash_at( i ) );
+      }
+      else {
+	if ( verbose ){
+	  cerr << "skip " << ana.word( i, 0 ) << endl;
+	}
+	++skipped;
+      }
+    }
+    return flat_set( std::move(result) );
+  }
+
+  flat_set read_anahash( const string& name,
+			 const int& low,
+			 const int& high,
+			 size_t& skipped,
+			 bool verbose ){
+    // read a text or a binary anagram hash file, whichever 'name' is
+    if ( is_anahash_bin( name ) ){
+      anahash_file ana( name );
+      return read_anahash( ana, low, high, skipped, verbose );
+    }
+    ifstream is( name );
+    return read_anahash( is, low, high, skipped, verbose );
+  }
+
+} // namespace ticcl
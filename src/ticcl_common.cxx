@@ -27,10 +27,12 @@
 #include "ticcutils/StringOps.h"
 #include "ticcutils/Unicode.h"
 #include "ticcl/ticcl_common.h"
+#include "unicode/locid.h"
 
 #include <cstdlib>
 #include <string>
 #include <vector>
+#include <algorithm>
 
 using namespace icu;
 using namespace std;
@@ -91,23 +93,122 @@ namespace ticcl {
     return result;
   }
 
-  unsigned int ldCompare( const UnicodeString& s1, const UnicodeString& s2 ){
-    const size_t len1 = s1.length(), len2 = s2.length();
-    vector<unsigned int> col(len2+1), prevCol(len2+1);
-    for ( unsigned int i = 0; i < prevCol.size(); ++i ){
-      prevCol[i] = i;
+  // the classes in an alphabet_table. Values from FIRST_VALUE on are
+  // indices in the table of alphabet values, plus FIRST_VALUE
+  static const uint16_t UNKNOWN = 0;
+  static const uint16_t SPACE = 1;
+  static const uint16_t PUNCT = 2;
+  static const uint16_t SLOW = 3;
+  static const uint16_t FIRST_VALUE = 4;
+
+  alphabet_table::alphabet_table( const map<UChar,bitType>& alphabet ){
+    assign( alphabet );
+  }
+
+  void alphabet_table::assign( const map<UChar,bitType>& alphabet ){
+    _alphabet = alphabet;
+    _index.clear();
+    _values.clear();
+    const string lang = Locale::getDefault().getLanguage();
+    if ( lang == "tr" || lang == "az" || lang == "lt" ){
+      // these have casing rules that look at the context. An empty
+      // table sends everything to the slow path
+      return;
+    }
+    if ( alphabet.size() > size_t(UINT16_MAX - FIRST_VALUE) ){
+      throw runtime_error( "alphabet too large" );
+    }
+    map<UChar,uint16_t> value_index;
+    for ( const auto& [uc,val] : alphabet ){
+      value_index[uc] = FIRST_VALUE + _values.size();
+      _values.push_back( val );
+    }
+    // lowercase every BMP code unit on its own, the way toLower() does for
+    // the whole word. Code units which don't map on exactly one code unit
+    // get 0, as do the surrogates.
+    vector<UChar> lower( 0x10000, 0 );
+    // always cover the scripts and punctuation blocks below U+3000, so
+    // words are only rarely sent to the slow path
+    size_t limit = 0x3000;
+    UnicodeString tmp;
+    for ( UChar32 c=0; c < 0x10000; ++c ){
+      if ( U_IS_SURROGATE( c ) ){
+	continue;
+      }
+      tmp.setTo( UChar(c) );
+      tmp.toLower();
+      if ( tmp.length() == 1 ){
+	lower[c] = tmp[0];
+	if ( value_index.find( tmp[0] ) != value_index.end() ){
+	  limit = max<size_t>( limit, c + 1 );
+	}
+      }
+    }
+    _index.resize( limit );
+    for ( size_t c=0; c < limit; ++c ){
+      UChar lc = lower[c];
+      if ( ( lc == 0 && c != 0 )
+	   || c == 0x03A3 ){
+	// multiple code units, a surrogate, or the context dependent
+	// GREEK CAPITAL LETTER SIGMA
+	_index[c] = SLOW;
+	continue;
+      }
+      auto it = value_index.find( lc );
+      if ( it != value_index.end() ){
+	_index[c] = it->second;
+      }
+      else if ( u_isspace( lc ) ){
+	_index[c] = SPACE;
+      }
+      else if ( ispunct( u_charType( lc ) ) ){
+	_index[c] = PUNCT;
+      }
+      else {
+	_index[c] = UNKNOWN;
+      }
     }
-    for ( unsigned int i = 0; i < len1; ++i ) {
-      col[0] = i+1;
-      for ( unsigned int j = 0; j < len2; ++j )
-	col[j+1] = min( min( 1 + col[j], 1 + prevCol[1 + j]),
-			prevCol[j] + (s1[i]==s2[j] ? 0 : 1) );
-      col.swap(prevCol);
+  }
+
+  bitType alphabet_table::hash( const UnicodeString& s, bool debug ) const {
+    // the same as ticcl::hash() with the alphabet map, but without
+    // lowercasing a copy of the word and without the map lookups
+    if ( debug ){
+      return ticcl::hash( s, _alphabet, true );
+    }
+    const UChar *buf = s.getBuffer();
+    const int32_t len = s.length();
+    const size_t limit = _index.size();
+    bitType result = 0;
+    bool multPunct = false;
+    for ( int32_t i=0; i < len; ++i ){
+      const UChar c = buf[i];
+      const uint16_t cls = ( c < limit ) ? _index[c] : SLOW;
+      if ( cls >= FIRST_VALUE ){
+	result += _values[cls-FIRST_VALUE];
+      }
+      else if ( cls == UNKNOWN ){
+	result += HonderdEenHash;
+      }
+      else if ( cls == PUNCT ){
+	if ( !multPunct ){
+	  result += HonderdHash;
+	  multPunct = true;
+	}
+      }
+      else if ( cls == SLOW ){
+	return ticcl::hash( s, _alphabet );
+      }
     }
-    unsigned int result = prevCol[len2];
     return result;
   }
 
+  bitType hash( const UnicodeString& s,
+		const alphabet_table& alphabet,
+		bool debug ){
+    return alphabet.hash( s, debug );
+  }
+
   bool fillAlphabet( istream& is,
 		     map<UChar,bitType>& alphabet,
 		     int clip ){
@@ -131,23 +232,79 @@ namespace ticcl {
     return true;
   }
 
-  set<bitType> read_bit_set( istream& is ){
-    set<bitType> result;
-    while ( is ){
-      bitType bit;
-      is >> bit;
+  flat_set::flat_set( vector<bitType>&& vals ){
+    assign( std::move(vals) );
+  }
+
+  void flat_set::assign( vector<bitType>&& vals ){
+    _vals = std::move(vals);
+    sort( _vals.begin(), _vals.end() );
+    _vals.erase( unique( _vals.begin(), _vals.end() ), _vals.end() );
+    _vals.shrink_to_fit();
+  }
+
+  flat_set::const_iterator flat_set::find( bitType v ) const {
+    auto it = lower_bound( v );
+    if ( it != end() && *it == v ){
+      return it;
+    }
+    return end();
+  }
+
+  flat_hash_set::flat_hash_set( const flat_set& vals ){
+    assign( vals );
+  }
+
+  void flat_hash_set::assign( const flat_set& vals ){
+    _size = vals.size();
+    _has_zero = false;
+    if ( vals.empty() ){
+      _table.clear();
+      _mask = 0;
+      _shift = 63;
+      _min = 1;
+      _max = 0;
+      return;
+    }
+    _min = vals.front();
+    _max = vals.back();
+    // a power of 2 size, with a load factor of at most 0.5
+    size_t bits = 1;
+    while ( (size_t(1) << bits) < 2 * _size ){
+      ++bits;
+    }
+    _shift = 64 - bits;
+    _mask = (size_t(1) << bits) - 1;
+    _table.assign( _mask + 1, 0 );
+    for ( const auto v : vals ){
+      if ( v == 0 ){
+	_has_zero = true;
+	continue;
+      }
+      size_t i = slot( v );
+      while ( _table[i] != 0 ){
+	i = (i+1) & _mask;
+      }
+      _table[i] = v;
+    }
+  }
+
+  flat_set read_bit_set( istream& is ){
+    vector<bitType> result;
+    bitType bit;
+    while ( is >> bit ){
       is.ignore( INT_MAX, '\n' );
-      result.insert( bit );
+      result.push_back( bit );
     }
-    return result;
+    return flat_set( std::move(result) );
   }
 
-  set<bitType> read_anahash( istream& is,
-			     const int& low,
-			     const int& high,
-			     size_t& skipped,
-			     bool verbose ){
-    set<bitType> result;
+  flat_set read_anahash( istream& is,
+			 const int& low,
+			 const int& high,
+			 size_t& skipped,
+			 bool verbose ){
+    vector<bitType> result;
     UnicodeString line;
     while ( TiCC::getline( is, line ) ){
       vector<UnicodeString> parts = TiCC::split_at( line, "~" );
@@ -158,7 +315,7 @@ namespace ticcl {
 	  UnicodeString firstItem = parts2[0];
 	  if ( firstItem.length() >= low &&
 	       firstItem.length() <= high ){
-	    result.insert( bit );
+	    result.push_back( bit );
 	  }
 	  else {
 	    if ( verbose ){
@@ -169,11 +326,11 @@ namespace ticcl {
 	}
       }
     }
-    return result;
+    return flat_set( std::move(result) );
   }
 
-  set<bitType> read_confusions( istream& is ){
-    set<bitType> result;
+  flat_set read_confusions( istream& is ){
+    vector<bitType> result;
     size_t count = 0;
     UnicodeString line;
     while ( TiCC::getline( is, line ) ){
@@ -187,7 +344,7 @@ namespace ticcl {
       vector<UnicodeString> parts = TiCC::split_at( line, "#" );
       if ( parts.size() > 0 ){
 	bitType bit = TiCC::stringTo<bitType>( parts[0] );
-	result.insert( bit );
+	result.push_back( bit );
       }
       else {
 	cerr << "problems with line " << line << endl;
@@ -195,7 +352,7 @@ namespace ticcl {
 	exit(1);
       }
     }
-    return result;
+    return flat_set( std::move(result) );
   }
 
 } // namespace ticcl
@@ -0,0 +1,160 @@
+/*
+  Copyright (c) 2026
+  CLST  - Radboud University
+
+  This file is part of ticcltools
+
+  ticcltools is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  ticcltools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/ticcltools/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include "ticcl/ticcl_common.h"
+
+using namespace std;
+
+namespace ticcl {
+
+  static const char index_magic[8] = { 'T','I','C','C','L','I','X','1' };
+  static const size_t index_header_size = sizeof(index_magic) + 8;
+
+  static void put_varint( string& buf, uint64_t v ){
+    while ( v >= 0x80 ){
+      buf += char( (v & 0x7F) | 0x80 );
+      v >>= 7;
+    }
+    buf += char( v );
+  }
+
+  static string index_header( uint64_t entries ){
+    // the magic, followed by the number of entries, little endian
+    string result( index_magic, sizeof(index_magic) );
+    for ( int i=0; i < 8; ++i ){
+      result += char( (entries >> (8*i)) & 0xFF );
+    }
+    return result;
+  }
+
+  bool is_index_bin( const string& name ){
+    ifstream is( name, ios::binary );
+    char magic[sizeof(index_magic)];
+    if ( !is.read( magic, sizeof(magic) ) ){
+      return false;
+    }
+    return memcmp( magic, index_magic, sizeof(magic) ) == 0;
+  }
+
+  index_writer::index_writer( ostream& os ): _os(os), _entries(0){
+    _start = _os.tellp();
+    _os << index_header( 0 );
+  }
+
+  void index_writer::encode( string& buf,
+			     bitType conf,
+			     const vector<bitType>& values ){
+    put_varint( buf, conf );
+    put_varint( buf, values.size() );
+    if ( is_sorted( values.begin(), values.end() ) ){
+      bitType prev = 0;
+      for ( const auto v : values ){
+	put_varint( buf, v - prev );
+	prev = v;
+      }
+    }
+    else {
+      vector<bitType> sorted = values;
+      sort( sorted.begin(), sorted.end() );
+      bitType prev = 0;
+      for ( const auto v : sorted ){
+	put_varint( buf, v - prev );
+	prev = v;
+      }
+    }
+  }
+
+  void index_writer::add( bitType conf, const vector<bitType>& values ){
+    string buf;
+    encode( buf, conf, values );
+    _os << buf;
+    ++_entries;
+  }
+
+  void index_writer::finish(){
+    // patch the header with the final number of entries
+    _os.flush();
+    streampos end = _os.tellp();
+    _os.seekp( _start );
+    _os << index_header( _entries );
+    _os.seekp( end );
+    _os.flush();
+    if ( !_os ){
+      throw runtime_error( "problem writing binary index file" );
+    }
+  }
+
+  index_reader::index_reader( istream& is ): _is(is), _entries(0), _read(0){
+    char head[index_header_size];
+    if ( !_is.read( head, sizeof(head) )
+	 || memcmp( head, index_magic, sizeof(index_magic) ) != 0 ){
+      throw runtime_error( "not a binary index file" );
+    }
+    for ( int i=7; i >= 0; --i ){
+      _entries = (_entries << 8)
+	| static_cast<unsigned char>( head[sizeof(index_magic)+i] );
+    }
+  }
+
+  uint64_t index_reader::get_varint(){
+    streambuf *sb = _is.rdbuf();
+    uint64_t result = 0;
+    for ( int shift = 0; shift < 64; shift += 7 ){
+      int c = sb->sbumpc();
+      if ( c == EOF ){
+	throw runtime_error( "truncated binary index file" );
+      }
+      result |= uint64_t( c & 0x7F ) << shift;
+      if ( !( c & 0x80 ) ){
+	return result;
+      }
+    }
+    throw runtime_error( "corrupt binary index file" );
+  }
+
+  bool index_reader::next( bitType& conf, vector<bitType>& values ){
+    values.clear();
+    if ( _read == _entries ){
+      return false;
+    }
+    conf = get_varint();
+    size_t len = get_varint();
+    values.reserve( len );
+    bitType prev = 0;
+    for ( size_t i=0; i < len; ++i ){
+      prev += get_varint();
+      values.push_back( prev );
+    }
+    ++_read;
+    return true;
+  }
+
+} // namespace ticcl
@@ -0,0 +1,283 @@
+/*
+  Copyright (c) 2026
+  CLST  - Radboud University
+
+  This file is part of ticcltools
+
+  ticcltools is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  ticcltools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/ticcltools/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include "ticcl/ticcl_common.h"
+
+#include <vector>
+#include <algorithm>
+
+#if defined(__x86_64__) && ( defined(__GNUC__) || defined(__clang__) )
+#define TICCL_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace ticcl {
+
+  static void linear_join( const bitType *vals,
+			   size_t i,
+			   size_t len_i,
+			   size_t j,
+			   size_t len_j,
+			   bitType shift,
+			   vector<bitType>& result ){
+    // a plain merge-join of vals[i,len_i) with vals[j,len_j) - shift
+    while ( i < len_i && j < len_j ){
+      bitType v1 = vals[i];
+      bitType v2 = vals[j] - shift;
+      if ( v1 == v2 ){
+	result.push_back( v1 );
+	++i;
+	++j;
+      }
+      else if ( v1 < v2 ){
+	++i;
+      }
+      else {
+	++j;
+      }
+    }
+  }
+
+  static inline size_t gallop( const bitType *vals,
+			       size_t pos,
+			       size_t len,
+			       bitType target ){
+    // return the first position >= pos where vals[pos] >= target
+    // first search exponentially for a range containing target,
+    // then bisect that range
+    size_t lo = pos;
+    size_t hi = pos;
+    size_t step = 1;
+    while ( hi < len && vals[hi] < target ){
+      lo = hi + 1;
+      hi += step;
+      step <<= 1;
+    }
+    if ( hi > len ){
+      hi = len;
+    }
+    return std::lower_bound( vals+lo, vals+hi, target ) - vals;
+  }
+
+  static void gallop_join( const bitType *vals,
+			   size_t len,
+			   bitType shift,
+			   size_t j,
+			   vector<bitType>& result ){
+    // like linear_join, but leap over runs of values that cannot match.
+    // Also stop as soon as v+shift exceeds the largest value.
+    const bitType max_low = vals[len-1] - shift;
+    size_t i = 0;
+    while ( i < len && j < len ){
+      bitType v1 = vals[i];
+      if ( v1 > max_low ){
+	break;
+      }
+      bitType v2 = vals[j] - shift;
+      if ( v1 == v2 ){
+	result.push_back( v1 );
+	++i;
+	++j;
+      }
+      else if ( v1 < v2 ){
+	i = gallop( vals, i+1, len, v2 );
+      }
+      else {
+	j = gallop( vals, j+1, len, v1 + shift );
+      }
+    }
+  }
+
+#ifdef TICCL_X86_SIMD
+  //
+  // block wise intersections: compare a block of low values with all
+  // rotations of a block of shifted high values, store the hits and then
+  // advance the block(s) with the smallest last value.
+  // Because both sides are strictly ascending, every low value matches at
+  // most once, and the hits come out in ascending order.
+  //
+  __attribute__((target("avx2")))
+  static void avx2_join( const bitType *vals,
+			 size_t len_i,
+			 size_t j,
+			 size_t len_j,
+			 bitType shift,
+			 vector<bitType>& result ){
+    const __m256i vshift = _mm256_set1_epi64x( shift );
+    size_t i = 0;
+    while ( i + 4 <= len_i && j + 4 <= len_j ){
+      __m256i a = _mm256_loadu_si256( (const __m256i*)(vals+i) );
+      __m256i b = _mm256_sub_epi64( _mm256_loadu_si256( (const __m256i*)(vals+j) ),
+				    vshift );
+      __m256i hits = _mm256_cmpeq_epi64( a, b );
+      __m256i rb = _mm256_permute4x64_epi64( b, _MM_SHUFFLE(0,3,2,1) );
+      hits = _mm256_or_si256( hits, _mm256_cmpeq_epi64( a, rb ) );
+      rb = _mm256_permute4x64_epi64( b, _MM_SHUFFLE(1,0,3,2) );
+      hits = _mm256_or_si256( hits, _mm256_cmpeq_epi64( a, rb ) );
+      rb = _mm256_permute4x64_epi64( b, _MM_SHUFFLE(2,1,0,3) );
+      hits = _mm256_or_si256( hits, _mm256_cmpeq_epi64( a, rb ) );
+      int mask = _mm256_movemask_pd( _mm256_castsi256_pd( hits ) );
+      while ( mask ){
+	result.push_back( vals[i+__builtin_ctz(mask)] );
+	mask &= mask - 1;
+      }
+      const bitType a_last = vals[i+3];
+      const bitType b_last = vals[j+3] - shift;
+      if ( a_last <= b_last ){
+	i += 4;
+      }
+      if ( b_last <= a_last ){
+	j += 4;
+      }
+    }
+    linear_join( vals, i, len_i, j, len_j, shift, result );
+  }
+
+  __attribute__((target("avx512f")))
+  static void avx512_join( const bitType *vals,
+			   size_t len_i,
+			   size_t j,
+			   size_t len_j,
+			   bitType shift,
+			   vector<bitType>& result ){
+    const __m512i vshift = _mm512_set1_epi64( shift );
+    size_t i = 0;
+    while ( i + 8 <= len_i && j + 8 <= len_j ){
+      __m512i a = _mm512_loadu_si512( vals+i );
+      __m512i b = _mm512_sub_epi64( _mm512_loadu_si512( vals+j ), vshift );
+      __mmask8 hits = _mm512_cmpeq_epi64_mask( a, b );
+      hits |= _mm512_cmpeq_epi64_mask( a, _mm512_maskz_alignr_epi64( 0xFF, b, b, 1 ) );
+      hits |= _mm512_cmpeq_epi64_mask( a, _mm512_maskz_alignr_epi64( 0xFF, b, b, 2 ) );
+      hits |= _mm512_cmpeq_epi64_mask( a, _mm512_maskz_alignr_epi64( 0xFF, b, b, 3 ) );
+      hits |= _mm512_cmpeq_epi64_mask( a, _mm512_maskz_alignr_epi64( 0xFF, b, b, 4 ) );
+      hits |= _mm512_cmpeq_epi64_mask( a, _mm512_maskz_alignr_epi64( 0xFF, b, b, 5 ) );
+      hits |= _mm512_cmpeq_epi64_mask( a, _mm512_maskz_alignr_epi64( 0xFF, b, b, 6 ) );
+      hits |= _mm512_cmpeq_epi64_mask( a, _mm512_maskz_alignr_epi64( 0xFF, b, b, 7 ) );
+      if ( hits ){
+	// squeeze the hits together, straight into the result
+	size_t pos = result.size();
+	result.resize( pos + 8 );
+	_mm512_mask_compressstoreu_epi64( result.data()+pos, hits, a );
+	result.resize( pos + __builtin_popcount( hits ) );
+      }
+      const bitType a_last = vals[i+7];
+      const bitType b_last = vals[j+7] - shift;
+      if ( a_last <= b_last ){
+	i += 8;
+      }
+      if ( b_last <= a_last ){
+	j += 8;
+      }
+    }
+    linear_join( vals, i, len_i, j, len_j, shift, result );
+  }
+
+  enum simd_level { NO_SIMD, AVX2_SIMD, AVX512_SIMD };
+
+  static simd_level detect_simd(){
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx512f" ) ){
+      return AVX512_SIMD;
+    }
+    if ( __builtin_cpu_supports( "avx2" ) ){
+      return AVX2_SIMD;
+    }
+    return NO_SIMD;
+  }
+
+  static simd_level cpu_simd(){
+    // detect once, on first use
+    static const simd_level level = detect_simd();
+    return level;
+  }
+#endif
+
+  static void simd_join( const bitType *vals,
+			 size_t len,
+			 bitType shift,
+			 size_t j,
+			 vector<bitType>& result ){
+    // only values <= max_low can be the lower one of a pair
+    const bitType max_low = vals[len-1] - shift;
+    size_t len_i = std::upper_bound( vals, vals+len, max_low ) - vals;
+#ifdef TICCL_X86_SIMD
+    switch ( cpu_simd() ){
+    case AVX512_SIMD:
+      avx512_join( vals, len_i, j, len, shift, result );
+      return;
+    case AVX2_SIMD:
+      avx2_join( vals, len_i, j, len, shift, result );
+      return;
+    case NO_SIMD:
+      break;
+    }
+#endif
+    linear_join( vals, 0, len_i, j, len, shift, result );
+  }
+
+  string simd_support(){
+#ifdef TICCL_X86_SIMD
+    switch ( cpu_simd() ){
+    case AVX512_SIMD:
+      return "AVX-512";
+    case AVX2_SIMD:
+      return "AVX2";
+    case NO_SIMD:
+      break;
+    }
+#endif
+    return "none";
+  }
+
+  void shifted_join( const flat_set& hashes,
+		     bitType shift,
+		     vector<bitType>& result,
+		     join_mode mode ){
+    // collect all values v from hashes for which v+shift is in hashes too.
+    // the result is in ascending order.
+    result.clear();
+    if ( hashes.empty()
+	 || shift > hashes.back() ){
+      return;
+    }
+    // values below shift can never be the higher one of a pair
+    size_t j = hashes.lower_bound( shift ) - hashes.begin();
+    switch ( mode ){
+    case LINEAR_JOIN:
+      linear_join( hashes.data(), 0, hashes.size(), j, hashes.size(),
+		   shift, result );
+      break;
+    case GALLOP_JOIN:
+      gallop_join( hashes.data(), hashes.size(), shift, j, result );
+      break;
+    case SIMD_JOIN:
+      simd_join( hashes.data(), hashes.size(), shift, j, result );
+      break;
+    }
+  }
+
+} // namespace ticcl
@@ -0,0 +1,278 @@
+/*
+  Copyright (c) 2019 - 2026
+  CLST  - Radboud University
+
+  This file is part of ticcltools
+
+  ticcltools is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  ticcltools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/ticcltools/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include "ticcl/ticcl_common.h"
+
+#include <vector>
+#include <algorithm>
+
+using namespace icu;
+using namespace std;
+
+namespace ticcl {
+
+  unsigned int ldCompareDP( const UnicodeString& s1, const UnicodeString& s2 ){
+    // the plain dynamic programming version. Kept as a reference for
+    // the bit-parallel implementation below
+    const size_t len1 = s1.length(), len2 = s2.length();
+    vector<unsigned int> col(len2+1), prevCol(len2+1);
+    for ( unsigned int i = 0; i < prevCol.size(); ++i ){
+      prevCol[i] = i;
+    }
+    for ( unsigned int i = 0; i < len1; ++i ) {
+      col[0] = i+1;
+      for ( unsigned int j = 0; j < len2; ++j )
+	col[j+1] = min( min( 1 + col[j], 1 + prevCol[1 + j]),
+			prevCol[j] + (s1[i]==s2[j] ? 0 : 1) );
+      col.swap(prevCol);
+    }
+    unsigned int result = prevCol[len2];
+    return result;
+  }
+
+  // Bit-parallel Levenshtein distance, after G. Myers (1999) and
+  // H. Hyyrö (2003). One column of the DP matrix is kept as two bit
+  // vectors of vertical +1 (Pv) and -1 (Mv) differences, and advanced one
+  // text character at a time with a handful of word operations.
+  // The pattern (the shorter string) is handled in blocks of 64 code units.
+
+  static unsigned int ld_single( const UChar *p, size_t m,
+				 const UChar *t, size_t n ){
+    // 0 < m <= 64. Match masks of code units below 256 live in a
+    // per thread table, which is cleaned up again afterwards. Others are
+    // looked up in a short list.
+    static thread_local uint64_t low_peq[256] = {0};
+    UChar high_c[64];
+    uint64_t high_peq[64];
+    size_t n_high = 0;
+    for ( size_t i=0; i < m; ++i ){
+      UChar c = p[i];
+      uint64_t bit = uint64_t(1) << i;
+      if ( c < 256 ){
+	low_peq[c] |= bit;
+      }
+      else {
+	size_t k = 0;
+	while ( k < n_high && high_c[k] != c ){
+	  ++k;
+	}
+	if ( k == n_high ){
+	  high_c[n_high] = c;
+	  high_peq[n_high++] = 0;
+	}
+	high_peq[k] |= bit;
+      }
+    }
+    const uint64_t last = uint64_t(1) << (m-1);
+    uint64_t Pv = ( m == 64 ) ? ~uint64_t(0) : ( (uint64_t(1) << m) - 1 );
+    uint64_t Mv = 0;
+    unsigned int score = m;
+    for ( size_t j=0; j < n; ++j ){
+      UChar c = t[j];
+      uint64_t Eq = 0;
+      if ( c < 256 ){
+	Eq = low_peq[c];
+      }
+      else {
+	for ( size_t k=0; k < n_high; ++k ){
+	  if ( high_c[k] == c ){
+	    Eq = high_peq[k];
+	    break;
+	  }
+	}
+      }
+      uint64_t Xv = Eq | Mv;
+      uint64_t Xh = (((Eq & Pv) + Pv) ^ Pv) | Eq;
+      uint64_t Ph = Mv | ~(Xh | Pv);
+      uint64_t Mh = Pv & Xh;
+      if ( Ph & last ){
+	++score;
+      }
+      else if ( Mh & last ){
+	--score;
+      }
+      // the top row of the matrix increases by 1 every column
+      Ph = (Ph << 1) | 1;
+      Mh <<= 1;
+      Pv = Mh | ~(Xv | Ph);
+      Mv = Ph & Xv;
+    }
+    for ( size_t i=0; i < m; ++i ){
+      if ( p[i] < 256 ){
+	low_peq[p[i]] = 0;
+      }
+    }
+    return score;
+  }
+
+  static unsigned int ld_blocks( const UChar *p, size_t m,
+				 const UChar *t, size_t n ){
+    // m > 64. Long n-grams are rare, so we don't mind allocating here
+    const size_t blocks = (m + 63) / 64;
+    vector<UChar> alpha( p, p+m );
+    sort( alpha.begin(), alpha.end() );
+    alpha.erase( unique( alpha.begin(), alpha.end() ), alpha.end() );
+    // one row of match masks per distinct code unit, and an all zero row
+    // for code units that don't occur in the pattern
+    vector<uint64_t> peq( (alpha.size()+1) * blocks, 0 );
+    for ( size_t i=0; i < m; ++i ){
+      size_t a = lower_bound( alpha.begin(), alpha.end(), p[i] ) - alpha.begin();
+      peq[a*blocks + i/64] |= uint64_t(1) << (i%64);
+    }
+    vector<uint64_t> Pv( blocks, ~uint64_t(0) ), Mv( blocks, 0 );
+    const uint64_t high = uint64_t(1) << 63;
+    const uint64_t last = uint64_t(1) << ((m-1) % 64);
+    unsigned int score = m;
+    for ( size_t j=0; j < n; ++j ){
+      auto it = lower_bound( alpha.begin(), alpha.end(), t[j] );
+      size_t a = alpha.size();
+      if ( it != alpha.end() && *it == t[j] ){
+	a = it - alpha.begin();
+      }
+      const uint64_t *Eqs = &peq[a*blocks];
+      int hin = 1; // the horizontal difference entering the top block
+      for ( size_t b=0; b < blocks; ++b ){
+	uint64_t Eq = Eqs[b];
+	uint64_t pv = Pv[b];
+	uint64_t mv = Mv[b];
+	uint64_t Xv = Eq | mv;
+	if ( hin < 0 ){
+	  Eq |= 1;
+	}
+	uint64_t Xh = (((Eq & pv) + pv) ^ pv) | Eq;
+	uint64_t Ph = mv | ~(Xh | pv);
+	uint64_t Mh = pv & Xh;
+	int hout = 0;
+	if ( b == blocks-1 ){
+	  // the bits above the pattern in the last block are ignored
+	  if ( Ph & last ){
+	    ++score;
+	  }
+	  else if ( Mh & last ){
+	    --score;
+	  }
+	}
+	else if ( Ph & high ){
+	  hout = 1;
+	}
+	else if ( Mh & high ){
+	  hout = -1;
+	}
+	Ph <<= 1;
+	Mh <<= 1;
+	if ( hin < 0 ){
+	  Mh |= 1;
+	}
+	else if ( hin > 0 ){
+	  Ph |= 1;
+	}
+	Pv[b] = Mh | ~(Xv | Ph);
+	Mv[b] = Ph & Xv;
+	hin = hout;
+      }
+    }
+    return score;
+  }
+
+  unsigned int ldCompare( const UnicodeString& s1, const UnicodeString& s2 ){
+    const UnicodeString *p = &s1;
+    const UnicodeString *t = &s2;
+    if ( p->length() > t->length() ){
+      swap( p, t );
+    }
+    const size_t m = p->length();
+    const size_t n = t->length();
+    if ( m == 0 ){
+      return n;
+    }
+    if ( m <= 64 ){
+      return ld_single( p->getBuffer(), m, t->getBuffer(), n );
+    }
+    return ld_blocks( p->getBuffer(), m, t->getBuffer(), n );
+  }
+
+  unsigned int ldWithin( const UnicodeString& s1,
+			 const UnicodeString& s2,
+			 unsigned int k,
+			 vector<unsigned int>& scratch ){
+    // Ukkonen's cut-off: only the diagonal band of width 2k+1 can hold
+    // values <= k, and once a whole row of the band exceeds k, so will the
+    // result. Cells outside the band are treated as k+1.
+    const size_t len1 = s1.length(), len2 = s2.length();
+    const unsigned int out = k + 1;
+    if ( ( len1 > len2 ? len1 - len2 : len2 - len1 ) > k ){
+      return out;
+    }
+    if ( scratch.size() < 2 * (len2 + 1) ){
+      scratch.resize( 2 * (len2 + 1) );
+    }
+    unsigned int *prev = scratch.data();
+    unsigned int *cur = prev + len2 + 1;
+    const UChar *p1 = s1.getBuffer();
+    const UChar *p2 = s2.getBuffer();
+    size_t hi = min<size_t>( k, len2 );
+    for ( size_t j=0; j <= hi; ++j ){
+      prev[j] = j;
+    }
+    if ( hi < len2 ){
+      prev[hi+1] = out;
+    }
+    for ( size_t i=1; i <= len1; ++i ){
+      size_t lo = ( i > k ) ? i - k : 0;
+      hi = min<size_t>( i + k, len2 );
+      unsigned int row_min = out;
+      if ( lo == 0 ){
+	cur[0] = min<unsigned int>( i, out );
+	row_min = cur[0];
+	lo = 1;
+      }
+      else {
+	cur[lo-1] = out;
+      }
+      const UChar c = p1[i-1];
+      for ( size_t j=lo; j <= hi; ++j ){
+	unsigned int v = prev[j-1] + ( c == p2[j-1] ? 0 : 1 );
+	v = min( v, prev[j] + 1 );
+	v = min( v, cur[j-1] + 1 );
+	if ( v > out ){
+	  v = out;
+	}
+	cur[j] = v;
+	if ( v < row_min ){
+	  row_min = v;
+	}
+      }
+      if ( row_min > k ){
+	return out;
+      }
+      if ( hi < len2 ){
+	cur[hi+1] = out;
+      }
+      swap( prev, cur );
+    }
+    return prev[len2];
+  }
+
+} // namespace ticcl
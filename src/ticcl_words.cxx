@@ -0,0 +1,371 @@
+/*
+  Copyright (c) 2019 - 2026
+  CLST  - Radboud University
+
+  This file is part of ticcltools
+
+  ticcltools is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  ticcltools is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/ticcltools/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <fstream>
+#include <stdexcept>
+#include "ticcl/ticcl_common.h"
+#include "config.h"
+#ifdef HAVE_OPENMP
+#include "omp.h"
+#endif
+
+using namespace std;
+using namespace icu;
+
+namespace ticcl {
+
+  static const char vocab_magic[8] = { 'T','I','C','C','L','V','C','1' };
+  static const uint64_t byte_order_mark = 0x0102030405060708ULL;
+
+  struct vocab_header {
+    // followed by:
+    //   uint64_t offs[N+1]    offset of every word in the pool
+    //   uint64_t counts[N]
+    //   uint32_t hashes[N]
+    //   uint32_t slots[S]     the lookup table, S is a power of 2
+    //   UChar    pool[P]      UTF-16 words, without separators
+    char magic[8];
+    uint64_t order;
+    uint64_t n_words;
+    uint64_t n_slots;
+    uint64_t pool_size;
+  };
+
+  static uint32_t word_hash( const UChar *w, size_t len ){
+    // FNV-1a over the code units. It is stored in vocabulary files,
+    // so don't change it.
+    uint32_t h = 2166136261U;
+    for ( size_t i=0; i < len; ++i ){
+      h ^= w[i];
+      h *= 16777619U;
+    }
+    return h;
+  }
+
+  word_table::word_table():
+    _pool(0),
+    _offs(0),
+    _counts(0),
+    _hashes(0),
+    _slots(0),
+    _size(0),
+    _mask(0),
+    _map(0),
+    _map_size(0)
+  {
+    close();
+  }
+
+  word_table::word_table( const string& name ):
+    word_table()
+  {
+    open( name );
+  }
+
+  word_table::~word_table(){
+    if ( _map ){
+      munmap( _map, _map_size );
+    }
+  }
+
+  void word_table::close(){
+    // back to an empty, writable table
+    if ( _map ){
+      munmap( _map, _map_size );
+    }
+    _map = 0;
+    _map_size = 0;
+    _pool_v.clear();
+    _offs_v.assign( 1, 0 );
+    _counts_v.clear();
+    _hashes_v.clear();
+    _slots_v.assign( 16, npos );
+    _size = 0;
+    _mask = _slots_v.size() - 1;
+    refresh();
+  }
+
+  void word_table::refresh(){
+    _pool = _pool_v.data();
+    _offs = _offs_v.data();
+    _counts = _counts_v.data();
+    _hashes = _hashes_v.data();
+    _slots = _slots_v.data();
+  }
+
+  uint32_t word_table::lookup( const UChar *w, size_t len, uint32_t h,
+			       size_t& slot ) const {
+    // returns the ID of the word, or npos. slot is set to the slot where
+    // the search ended
+    for ( slot = h & _mask; ; slot = (slot+1) & _mask ){
+      uint32_t id = _slots[slot];
+      if ( id == npos ){
+	return npos;
+      }
+      if ( _hashes[id] == h
+	   && length( id ) == len
+	   && ( len == 0
+		|| memcmp( data( id ), w, len * sizeof(UChar) ) == 0 ) ){
+	return id;
+      }
+    }
+  }
+
+  uint32_t word_table::find( const UnicodeString& w ) const {
+    const UChar *buf = w.getBuffer();
+    const size_t len = w.length();
+    size_t slot;
+    return lookup( buf, len, word_hash( buf, len ), slot );
+  }
+
+  uint32_t word_table::intern( const UnicodeString& w ){
+    if ( read_only() ){
+      throw runtime_error( "word_table: cannot add words to a mapped vocabulary" );
+    }
+    const UChar *buf = w.getBuffer();
+    const size_t len = w.length();
+    const uint32_t h = word_hash( buf, len );
+    size_t slot;
+    uint32_t id = lookup( buf, len, h, slot );
+    if ( id != npos ){
+      return id;
+    }
+    if ( _size >= npos - 1 ){
+      throw runtime_error( "word_table: too many words" );
+    }
+    id = _size++;
+    _pool_v.insert( _pool_v.end(), buf, buf + len );
+    _offs_v.push_back( _pool_v.size() );
+    _counts_v.push_back( 0 );
+    _hashes_v.push_back( h );
+    _slots_v[slot] = id;
+    refresh();
+    if ( 2 * _size > _slots_v.size() ){
+      grow();
+    }
+    return id;
+  }
+
+  void word_table::grow(){
+    // double the lookup table, keeping the load factor below 0.5
+    _slots_v.assign( 2 * _slots_v.size(), npos );
+    _mask = _slots_v.size() - 1;
+    for ( uint32_t id=0; id < _size; ++id ){
+      size_t slot = _hashes_v[id] & _mask;
+      while ( _slots_v[slot] != npos ){
+	slot = (slot+1) & _mask;
+      }
+      _slots_v[slot] = id;
+    }
+    refresh();
+  }
+
+  void word_table::set_count( uint32_t id, uint64_t count ){
+    if ( read_only() ){
+      throw runtime_error( "word_table: cannot change a mapped vocabulary" );
+    }
+    _counts_v[id] = count;
+  }
+
+  vector<uint32_t> word_table::sorted() const {
+    vector<uint32_t> result( _size );
+    iota( result.begin(), result.end(), 0 );
+    sort( result.begin(), result.end(),
+	  [this]( uint32_t a, uint32_t b ){
+	    // code unit order, like UnicodeString::operator<
+	    return word( a ) < word( b );
+	  } );
+    return result;
+  }
+
+  void word_table::write( ostream& os ) const {
+    vocab_header head;
+    memcpy( head.magic, vocab_magic, sizeof(vocab_magic) );
+    head.order = byte_order_mark;
+    head.n_words = _size;
+    head.n_slots = _mask + 1;
+    head.pool_size = _offs[_size];
+    os.write( reinterpret_cast<const char*>(&head), sizeof(head) );
+    os.write( reinterpret_cast<const char*>(_offs),
+	      (_size+1) * sizeof(uint64_t) );
+    os.write( reinterpret_cast<const char*>(_counts),
+	      _size * sizeof(uint64_t) );
+    os.write( reinterpret_cast<const char*>(_hashes),
+	      _size * sizeof(uint32_t) );
+    os.write( reinterpret_cast<const char*>(_slots),
+	      head.n_slots * sizeof(uint32_t) );
+    os.write( reinterpret_cast<const char*>(_pool),
+	      head.pool_size * sizeof(UChar) );
+    if ( !os ){
+      throw runtime_error( "problem writing vocabulary file" );
+    }
+  }
+
+  void word_table::open( const string& name ){
+    close();
+    int fd = ::open( name.c_str(), O_RDONLY );
+    if ( fd < 0 ){
+      throw runtime_error( "unable to open vocabulary file: " + name );
+    }
+    struct stat st;
+    if ( fstat( fd, &st ) != 0
+	 || size_t(st.st_size) < sizeof(vocab_header) ){
+      ::close( fd );
+      throw runtime_error( "invalid vocabulary file: " + name );
+    }
+    _map_size = st.st_size;
+    _map = mmap( 0, _map_size, PROT_READ, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if ( _map == MAP_FAILED ){
+      _map = 0;
+      _map_size = 0;
+      throw runtime_error( "unable to map vocabulary file: " + name );
+    }
+    const vocab_header *head = static_cast<const vocab_header*>(_map);
+    if ( memcmp( head->magic, vocab_magic, sizeof(vocab_magic) ) != 0
+	 || head->order != byte_order_mark ){
+      close();
+      throw runtime_error( "not a vocabulary file (or wrong byte order): "
+			   + name );
+    }
+    const size_t n = head->n_words;
+    const size_t s = head->n_slots;
+    const size_t expected = sizeof(vocab_header)
+      + (n+1) * sizeof(uint64_t)
+      + n * sizeof(uint64_t)
+      + n * sizeof(uint32_t)
+      + s * sizeof(uint32_t)
+      + head->pool_size * sizeof(UChar);
+    if ( expected != _map_size
+	 || s == 0 || ( s & (s-1) ) != 0 || 2 * n > s ){
+      close();
+      throw runtime_error( "corrupt vocabulary file: " + name );
+    }
+    const char *p = static_cast<const char*>(_map) + sizeof(vocab_header);
+    _offs = reinterpret_cast<const uint64_t*>(p);
+    p += (n+1) * sizeof(uint64_t);
+    _counts = reinterpret_cast<const uint64_t*>(p);
+    p += n * sizeof(uint64_t);
+    _hashes = reinterpret_cast<const uint32_t*>(p);
+    p += n * sizeof(uint32_t);
+    _slots = reinterpret_cast<const uint32_t*>(p);
+    p += s * sizeof(uint32_t);
+    _pool = reinterpret_cast<const UChar*>(p);
+    _size = n;
+    _mask = s - 1;
+    // the vectors aren't used for a mapped table
+    _pool_v.clear();
+    _offs_v.clear();
+    _slots_v.clear();
+  }
+
+  bool is_vocab_file( const string& name ){
+    ifstream is( name, ios::binary );
+    char magic[sizeof(vocab_magic)];
+    if ( !is.read( magic, sizeof(magic) ) ){
+      return false;
+    }
+    return memcmp( magic, vocab_magic, sizeof(magic) ) == 0;
+  }
+
+  uint32_t lexicon::add( const UnicodeString& w ){
+    uint32_t id = _words.intern( w );
+    if ( id == _low_ids.size() ){
+      // a new word
+      UnicodeString lw = w;
+      lw.toLower();
+      _low_ids.push_back( _low.intern( lw ) );
+    }
+    return id;
+  }
+
+  uint64_t lexicon::freq_of( const UnicodeString& w ) const {
+    uint32_t id = _words.find( w );
+    return ( id == word_table::npos ) ? 0 : _words.count( id );
+  }
+
+  uint64_t lexicon::low_freq_of( const UnicodeString& lw ) const {
+    uint32_t l = _low.find( lw );
+    return ( l == word_table::npos ) ? 0 : _low.count( l );
+  }
+
+  word_counter::word_counter(){
+    size_t threads = 1;
+#ifdef HAVE_OPENMP
+    threads = omp_get_max_threads();
+#endif
+    for ( size_t i=0; i <= threads; ++i ){
+      _tables.emplace_back( new word_table() );
+    }
+  }
+
+  static void add_to( word_table& table, const UnicodeString& w, uint64_t n ){
+    uint32_t id = table.intern( w );
+    table.set_count( id, table.count( id ) + n );
+  }
+
+  void word_counter::add( const UnicodeString& w, uint64_t n ){
+    size_t thread = 0;
+    bool nested = false;
+#ifdef HAVE_OPENMP
+    thread = omp_get_thread_num();
+    // in a nested region, the thread number is only unique within the
+    // innermost team, so it doesn't tell the running threads apart.
+    // This also holds for inactive nested regions of just 1 thread
+    nested = omp_get_level() > 1;
+#endif
+    if ( !nested && thread + 1 < _tables.size() ){
+      add_to( *_tables[thread], w, n );
+    }
+    else {
+#pragma omp critical (word_counter)
+      {
+	add_to( *_tables.back(), w, n );
+      }
+    }
+  }
+
+  const word_table& word_counter::merge(){
+    // everything goes into the first table
+    word_table& result = *_tables[0];
+    for ( size_t i=1; i < _tables.size(); ++i ){
+      word_table& table = *_tables[i];
+      for ( uint32_t id=0; id < table.size(); ++id ){
+	add_to( result, table.word( id ), table.count( id ) );
+      }
+      _tables[i].reset( new word_table() );
+    }
+    return result;
+  }
+
+} // namespace ticcl
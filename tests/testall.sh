@@ -43,6 +43,27 @@ then
     exit
 fi
 
+echo "start TICCL-mergelex"
+
+awk '{print $1 "\t" NR%3}' $datadir/nld.aspell.dict > $outdir/lex1.tsv
+awk '{print tolower($1) "\t" NR%5}' $datadir/nld.aspell.dict > $outdir/lex2.tsv
+$bindir/TICCL-mergelex -o $outdir/merged $outdir/lex1.tsv $outdir/lex2.tsv
+$bindir/TICCL-mergelex --memory=1 -o $outdir/merged.ext $outdir/lex1.tsv $outdir/lex2.tsv
+
+if [ $? -ne 0 ]
+then
+    echo "failed in TICCL-mergelex"
+    exit
+fi
+
+diff $outdir/merged.ext.wordfreqlist.tsv $outdir/merged.wordfreqlist.tsv > /dev/null 2>&1
+if [ $? -ne 0 ]
+then
+    echo "differences in Ticcl-mergelex --memory results"
+    echo "using: diff $outdir/merged.ext.wordfreqlist.tsv $outdir/merged.wordfreqlist.tsv"
+    exit
+fi
+
 echo "start FoLiA-stats..."
 
 $bindir/FoLiA-stats -R -s -t max -e folia.xml$ --lang=none --class=OCR --ngram 1 -o $outdir/TESTDP035 --hemp=$outdir/TESTDP035.hemp FOLIA/
@@ -97,7 +118,7 @@ fi
 
 echo "start TICLL-anahash"
 
-$bindir/TICCL-anahash --alph $outdir/aspell.clip20.lc.chars --artifrq 100000000 $outdir/TESTDP035.clean
+$bindir/TICCL-anahash --bin --alph $outdir/aspell.clip20.lc.chars --artifrq 100000000 $outdir/TESTDP035.clean
 
 if [ $? -ne 0 ]
 then
@@ -136,6 +157,18 @@ then
     exit
 fi
 
+$bindir/TICCL-indexer -t max --join=linear --hash $outdir/TESTDP035.clean.anahash --charconf $outdir/aspell.clip20.ld2.charconfus --foci $outdir/TESTDP035.clean.corpusfoci -o $outdir/TESTDP035.linear
+
+LC_ALL=C sort $outdir/TESTDP035.linear.index > /tmp/sorted.linear.index
+diff /tmp/sorted.linear.index $refdir/index > /dev/null 2>&1
+
+if [ $? -ne 0 ]
+then
+    echo "differences in Ticcl-indexer --join=linear results"
+    echo "using diff /tmp/sorted.linear.index $refdir/index"
+    exit
+fi
+
 echo "start TICLL-LDcalc"
 
 $bindir/TICCL-LDcalc --index $outdir/TESTDP035.clean.index --hash $outdir/TESTDP035.clean.anahash --clean $outdir/TESTDP035.clean --LD 2 -t max --artifrq 100000000 -o $outdir/TESTDP035.clean.ldcalc
@@ -158,6 +191,38 @@ then
     exit
 fi
 
+$bindir/TICCL-indexer -t max --bin --hash $outdir/TESTDP035.clean.anahash.bin --charconf $outdir/aspell.clip20.ld2.charconfus --foci $outdir/TESTDP035.clean.corpusfoci -o $outdir/TESTDP035.bin
+
+$bindir/TICCL-LDcalc --index $outdir/TESTDP035.bin.index --hash $outdir/TESTDP035.clean.anahash.bin --clean $outdir/TESTDP035.clean --LD 2 -t max --artifrq 100000000 -o $outdir/TESTDP035.bin.ldcalc
+
+LC_ALL=C sort $outdir/TESTDP035.bin.ldcalc  > /tmp/bin.ldcalc
+diff /tmp/bin.ldcalc $refdir/ldcalc > /dev/null 2>&1
+
+if [ $? -ne 0 ]
+then
+    echo "differences in Ticcl-ldcalc results using binary anahash and index files"
+    echo "using: diff /tmp/bin.ldcalc $refdir/ldcalc"
+    exit
+fi
+
+$bindir/TICCL-LDcalc --index $outdir/TESTDP035.clean.index --hash $outdir/TESTDP035.clean.anahash --clean $outdir/TESTDP035.clean --LD 2 -t max --artifrq 100000000 --maxmem=1 -o $outdir/TESTDP035.maxmem.ldcalc
+
+if [ $? -ne 0 ]
+then
+    echo "failed in TICCL-LDcalc --maxmem"
+    exit
+fi
+
+LC_ALL=C sort $outdir/TESTDP035.maxmem.ldcalc  > /tmp/maxmem.ldcalc
+diff /tmp/maxmem.ldcalc $refdir/ldcalc > /dev/null 2>&1
+
+if [ $? -ne 0 ]
+then
+    echo "differences in Ticcl-ldcalc results using --maxmem"
+    echo "using: diff /tmp/maxmem.ldcalc $refdir/ldcalc"
+    exit
+fi
+
 echo "start TICLL-rank"
 
 $bindir/TICCL-rank -t max --alph $outdir/aspell.clip20.lc.chars --charconf $outdir/aspell.clip20.ld2.charconfus -o $outdir/TESTDP035.ldcalc.ranked --debugfile $outdir/.TESTDP035.ldcalc.debug.ranked --artifrq 0 --clip 5 --skipcols=10,11 $outdir/TESTDP035.clean.ldcalc 2> $outdir/.TESTDP035.RANK.stderr
@@ -51,4 +51,40 @@ then
     exit
 fi
 
+echo "checking TICCL-stats --split...."
+$bindir/TICCL-stats --ngram=3 $datadir/nld.aspell.dict -o $outdir/dict
+$bindir/TICCL-stats --ngram=3 -t 2 --split=1 $datadir/nld.aspell.dict -o $outdir/dict.split
+
+if [ $? -ne 0 ]
+then
+    echo "failed in TICLL-stats --split"
+    exit
+fi
+
+diff $outdir/dict.split.wordfreqlist.3.tsv $outdir/dict.wordfreqlist.3.tsv > /dev/null 2>&1
+if [ $? -ne 0 ]
+then
+    echo "differences in Ticcl-stats --split results"
+    echo "using: diff $outdir/dict.split.wordfreqlist.3.tsv $outdir/dict.wordfreqlist.3.tsv"
+    exit
+fi
+
+echo "checking TICCL-stats --stream...."
+$bindir/TICCL-stats --ngram=2 -X -R -e "xml$" BOOK -o $outdir/book
+$bindir/TICCL-stats --ngram=2 -X --stream -R -e "xml$" BOOK -o $outdir/book.stream
+
+if [ $? -ne 0 ]
+then
+    echo "failed in TICLL-stats --stream"
+    exit
+fi
+
+diff $outdir/book.stream.wordfreqlist.2.tsv $outdir/book.wordfreqlist.2.tsv > /dev/null 2>&1
+if [ $? -ne 0 ]
+then
+    echo "differences in Ticcl-stats --stream results"
+    echo "using: diff $outdir/book.stream.wordfreqlist.2.tsv $outdir/book.wordfreqlist.2.tsv"
+    exit
+fi
+
 echo "done"